@@ -1,6 +1,10 @@
 #include <benchmark/benchmark_api.h>
 #include <rapidhttp/document.h>
+#include <rapidhttp/document_pool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <type_traits>
 #if PROFILE
 #include <gperftools/profiler.h>
 #endif
@@ -50,8 +54,146 @@ static std::string c_big_request =
 "Transfer-Encoding: chunked\r\n"
 "Cache-Control: max-age=0\r\n\r\nb\r\nhello world\r\n0\r\n\r\n";
 
+static std::string c_query_uri =
+"/search?q=http+parser&lang=zh-CN&page=2&size=20&sort=desc&from=home&utm_source=bench&token=a1b2c3d4";
+
+// 文档分配器向上游申请内存的次数, 用于报告每次解析的内存分配次数.
+// 只统计通过document的Alloc参数分配的内存(字段, 容器, arena), 不替换全局operator new.
+static size_t g_alloc_count = 0;
+
+// 计数的分配器, 其余与std::allocator相同
+template <typename T>
+struct CountingAllocator
+{
+    typedef T value_type;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(CountingAllocator<U> const&) {}
+
+    T* allocate(size_t n)
+    {
+        ++g_alloc_count;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(CountingAllocator<U> const&) const { return true; }
+    template <typename U>
+    bool operator!=(CountingAllocator<U> const&) const { return false; }
+};
+
+// 简单的线程局部内存池: 按2的幂分级的空闲链表, 释放的内存只回到本线程的链表中.
+// 空闲链表为空时向operator new申请, 计入g_alloc_count
+struct ThreadPool
+{
+    enum { kMinShift = 4, kMaxShift = 16, kClasses = kMaxShift - kMinShift + 1 };
+
+    static void*& FreeList(size_t index)
+    {
+        static thread_local void* lists[kClasses] = {};
+        return lists[index];
+    }
+
+    static size_t ClassIndex(size_t bytes)
+    {
+        size_t index = 0;
+        while (((size_t)1 << (index + kMinShift)) < bytes)
+            ++index;
+        return index;
+    }
+
+    static void* Allocate(size_t bytes)
+    {
+        size_t index = ClassIndex(bytes);
+        if (index >= kClasses) {
+            ++g_alloc_count;
+            return ::operator new(bytes);
+        }
+        void*& head = FreeList(index);
+        if (!head) {
+            ++g_alloc_count;
+            return ::operator new((size_t)1 << (index + kMinShift));
+        }
+        void* p = head;
+        head = *(void**)p;
+        return p;
+    }
+
+    static void Deallocate(void* p, size_t bytes)
+    {
+        size_t index = ClassIndex(bytes);
+        if (index >= kClasses)
+            return ::operator delete(p);
+        void*& head = FreeList(index);
+        *(void**)p = head;
+        head = p;
+    }
+};
+
+template <typename T>
+struct PoolAllocator
+{
+    typedef T value_type;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(PoolAllocator<U> const&) {}
+
+    T* allocate(size_t n) { return (T*)ThreadPool::Allocate(n * sizeof(T)); }
+    void deallocate(T* p, size_t n) { ThreadPool::Deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(PoolAllocator<U> const&) const { return true; }
+    template <typename U>
+    bool operator!=(PoolAllocator<U> const&) const { return false; }
+};
+
+typedef rapidhttp::TAllocHttpDocument<CountingAllocator<char>> CountingHttpDocument;
+typedef rapidhttp::TAllocHttpDocumentRef<CountingAllocator<char>> CountingHttpDocumentRef;
+typedef rapidhttp::TAllocHttpDocument<CountingAllocator<char>, rapidhttp::NativeBackend> CountingNativeHttpDocument;
+typedef rapidhttp::TAllocHttpDocumentRef<CountingAllocator<char>, rapidhttp::NativeBackend> CountingNativeHttpDocumentRef;
+typedef rapidhttp::TAllocHttpDocument<PoolAllocator<char>> PoolHttpDocument;
+typedef rapidhttp::TAllocHttpDocumentRef<PoolAllocator<char>> PoolHttpDocumentRef;
+
+// DocType的分配次数是否会计入g_alloc_count
+template <typename DocType>
+struct IsCountedDocument : std::false_type {};
+template <typename S, typename B>
+struct IsCountedDocument<rapidhttp::THttpDocument<S, B, CountingAllocator<char>>> : std::true_type {};
+template <typename S, typename B>
+struct IsCountedDocument<rapidhttp::THttpDocument<S, B, PoolAllocator<char>>> : std::true_type {};
+
+// 在label中报告平均每次解析的内存分配次数, 只对使用计数分配器的DocType报告
+// @parses_per_iteration: 每次迭代解析的消息数, 默认为range(0)
+template <typename DocType>
+struct AllocReporter
+{
+    benchmark::State& state;
+    size_t begin;
+    size_t parses_per_iteration;
+
+    explicit AllocReporter(benchmark::State& s, size_t n = 0)
+        : state(s), begin(g_alloc_count), parses_per_iteration(n ? n : s.range(0))
+    {}
+
+    ~AllocReporter()
+    {
+        size_t parses = state.iterations() * parses_per_iteration;
+        if (!IsCountedDocument<DocType>::value || !parses)
+            return;
+
+        char label[64];
+        snprintf(label, sizeof(label), "allocs/parse=%.2f",
+                (double)(g_alloc_count - begin) / parses);
+        state.SetLabel(label);
+    }
+};
+
 template <class DocType> void BM_ParseRequest_0_field(benchmark::State& state)
 {
+    AllocReporter<DocType> allocs(state);
     while (state.KeepRunning()) {
         for (int x = 0; x < state.range(0); ++x) {
             DocType doc(rapidhttp::Request);
@@ -64,6 +206,7 @@ template <class DocType> void BM_ParseRequest_0_field(benchmark::State& state)
 
 template <class DocType> void BM_ParseRequest_1_field(benchmark::State& state)
 {
+    AllocReporter<DocType> allocs(state);
     while (state.KeepRunning()) {
         for (int x = 0; x < state.range(0); ++x) {
             DocType doc(rapidhttp::Request);
@@ -76,6 +219,7 @@ template <class DocType> void BM_ParseRequest_1_field(benchmark::State& state)
 
 template <class DocType> void BM_ParseRequest_2_field(benchmark::State& state)
 {
+    AllocReporter<DocType> allocs(state);
     while (state.KeepRunning()) {
         for (int x = 0; x < state.range(0); ++x) {
             DocType doc(rapidhttp::Request);
@@ -88,6 +232,7 @@ template <class DocType> void BM_ParseRequest_2_field(benchmark::State& state)
 
 template <class DocType> void BM_ParseRequest_3_field(benchmark::State& state)
 {
+    AllocReporter<DocType> allocs(state);
     while (state.KeepRunning()) {
         for (int x = 0; x < state.range(0); ++x) {
             DocType doc(rapidhttp::Request);
@@ -100,6 +245,7 @@ template <class DocType> void BM_ParseRequest_3_field(benchmark::State& state)
 
 template <class DocType> void BM_ParseRequest_big(benchmark::State& state)
 {
+    AllocReporter<DocType> allocs(state);
     while (state.KeepRunning()) {
         for (int x = 0; x < state.range(0); ++x) {
             DocType doc(rapidhttp::Request);
@@ -110,6 +256,157 @@ template <class DocType> void BM_ParseRequest_big(benchmark::State& state)
     }
 }
 
+// c_big_request分成多次输入, 每次8字节
+template <class DocType> void BM_ParseRequest_fragmented(benchmark::State& state)
+{
+    std::vector<std::string> pieces;
+    for (size_t pos = 0; pos < c_big_request.size(); pos += 8)
+        pieces.push_back(c_big_request.substr(pos, 8));
+
+    AllocReporter<DocType> allocs(state);
+    while (state.KeepRunning()) {
+        for (int x = 0; x < state.range(0); ++x) {
+            DocType doc(rapidhttp::Request);
+            for (auto const& piece : pieces)
+                doc.PartailParse(piece);
+            benchmark::DoNotOptimize(doc.ParseDone());
+        }
+    }
+}
+
+// 环形缓冲区中回绕成两段的c_big_request.
+// range(0)为0时先拷贝到线性缓冲区再解析, 为1时直接按iovec解析
+template <class DocType> void BM_ParseRequest_iovec(benchmark::State& state)
+{
+    size_t split = c_big_request.size() / 2;
+    struct iovec iov[2] = {
+        {(void*)c_big_request.c_str(), split},
+        {(void*)(c_big_request.c_str() + split), c_big_request.size() - split},
+    };
+
+    DocType doc(rapidhttp::Request);
+    std::string linear;
+    AllocReporter<DocType> allocs(state, 1);
+    while (state.KeepRunning()) {
+        if (state.range(0)) {
+            doc.PartailParse(iov, 2);
+        } else {
+            linear.assign((const char*)iov[0].iov_base, iov[0].iov_len);
+            linear.append((const char*)iov[1].iov_base, iov[1].iov_len);
+            doc.PartailParse(linear);
+        }
+        benchmark::DoNotOptimize(doc.ParseDone());
+    }
+}
+
+// keep-alive链接上连续的c_big_request, 每次迭代解析整个流.
+// range(0)为0时每次迭代新建document, 为1时从线程局部的池中取
+template <class DocType> void BM_KeepAliveStream(benchmark::State& state)
+{
+    const size_t messages = 8;
+    std::string stream;
+    for (size_t i = 0; i < messages; ++i)
+        stream += c_big_request;
+
+    typedef rapidhttp::TDocumentPool<DocType> Pool;
+    // 预热: 池中的document已经解析过同样的消息
+    if (state.range(0))
+        Pool::ThreadLocal().Acquire(rapidhttp::Request)->ParseAll(
+                stream.c_str(), stream.size(), [](DocType &){});
+
+    AllocReporter<DocType> allocs(state, messages);
+    while (state.KeepRunning()) {
+        size_t n = 0;
+        auto cb = [&](DocType &){ ++n; };
+        if (state.range(0)) {
+            typename Pool::pointer doc = Pool::ThreadLocal().Acquire(rapidhttp::Request);
+            doc->ParseAll(stream.c_str(), stream.size(), cb);
+        } else {
+            DocType doc(rapidhttp::Request);
+            doc.ParseAll(stream.c_str(), stream.size(), cb);
+        }
+        benchmark::DoNotOptimize(n);
+    }
+}
+
+// 解析后让HttpDocumentRef脱离输入缓冲区
+// Arg(0): CopyTo一个HttpDocument; Arg(1): Freeze
+static void BM_DetachRef(benchmark::State& state)
+{
+    CountingHttpDocumentRef doc(rapidhttp::Request);
+    AllocReporter<CountingHttpDocumentRef> allocs(state, 1);
+    while (state.KeepRunning()) {
+        doc.PartailParse(c_big_request);
+        if (state.range(0)) {
+            doc.Freeze();
+            benchmark::DoNotOptimize(doc.GetUri());
+        } else {
+            CountingHttpDocument clone(rapidhttp::Request);
+            doc.CopyTo(clone);
+            benchmark::DoNotOptimize(clone.GetUri());
+        }
+    }
+}
+
+// 构造并析构一个document, label中是sizeof(DocType)
+template <class DocType> void BM_ConstructDocument(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        DocType doc(rapidhttp::Request);
+        benchmark::DoNotOptimize(doc);
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "sizeof=%zu", sizeof(DocType));
+    state.SetLabel(label);
+}
+
+// 用document的分配器创建和销毁document, 这样这次分配也会被计数
+template <typename DocType>
+struct DocDeleter
+{
+    typedef typename DocType::template rebind_alloc_t<DocType> allocator_type;
+
+    static DocType* New()
+    {
+        DocType* p = allocator_type().allocate(1);
+        return new (p) DocType(rapidhttp::Request);
+    }
+
+    void operator()(DocType* p) const
+    {
+        p->~DocType();
+        allocator_type().deallocate(p, 1);
+    }
+};
+
+// 解析后的document经过队列移交给另一个线程处理
+// Arg(0): unique_ptr, 每个请求分配一个document; Arg(1): 直接移动document
+template <class DocType> void BM_MoveThroughQueue(benchmark::State& state)
+{
+    typedef std::unique_ptr<DocType, DocDeleter<DocType>> DocPtr;
+    std::vector<DocPtr> ptr_queue;
+    std::vector<DocType> doc_queue;
+    ptr_queue.reserve(1);
+    doc_queue.reserve(1);
+
+    AllocReporter<DocType> allocs(state, 1);
+    while (state.KeepRunning()) {
+        if (state.range(0)) {
+            DocType doc(rapidhttp::Request);
+            doc.PartailParse(c_http_request);
+            doc_queue.push_back(std::move(doc));
+            benchmark::DoNotOptimize(doc_queue.back().GetUri());
+            doc_queue.clear();
+        } else {
+            DocPtr doc(DocDeleter<DocType>::New());
+            doc->PartailParse(c_http_request);
+            ptr_queue.push_back(std::move(doc));
+            benchmark::DoNotOptimize(ptr_queue.back()->GetUri());
+            ptr_queue.clear();
+        }
+    }
+}
+
 template <class DocType> void BM_ParseResponse(benchmark::State& state)
 {
     while (state.KeepRunning()) {
@@ -167,11 +464,124 @@ template <class Src, class Dst> void BM_CopyTo(benchmark::State& state)
     }
 }
 
+// 拷贝uri后按'&'和'='切分
+void BM_QueryNaiveSplit(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        for (int x = 0; x < state.range(0); ++x) {
+            std::string uri = c_query_uri;
+            std::string query = uri.substr(uri.find('?') + 1);
+            std::vector<std::pair<std::string, std::string>> params;
+            size_t pos = 0;
+            while (pos < query.size()) {
+                size_t amp = query.find('&', pos);
+                if (amp == std::string::npos) amp = query.size();
+                std::string kv = query.substr(pos, amp - pos);
+                size_t eq = kv.find('=');
+                if (eq == std::string::npos)
+                    params.emplace_back(kv, "");
+                else
+                    params.emplace_back(kv.substr(0, eq), kv.substr(eq + 1));
+                pos = amp + 1;
+            }
+            benchmark::DoNotOptimize(params.data());
+        }
+    }
+}
+
+void BM_QueryIterator(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        for (int x = 0; x < state.range(0); ++x) {
+            rapidhttp::UrlView url;
+            url.Parse(c_query_uri.c_str(), c_query_uri.size(), false);
+            rapidhttp::QueryIterator it(url.query);
+            rapidhttp::StringRef k, v;
+            while (it.Next(k, v))
+                benchmark::DoNotOptimize(v.c_str());
+        }
+    }
+}
+
+void BM_QueryIteratorDecode(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        for (int x = 0; x < state.range(0); ++x) {
+            rapidhttp::UrlView url;
+            url.Parse(c_query_uri.c_str(), c_query_uri.size(), false);
+            rapidhttp::QueryIterator it(url.query);
+            rapidhttp::StringRef k, v;
+            char buf[64];
+            while (it.Next(k, v)) {
+                long n = rapidhttp::PercentDecode(v.c_str(), v.size(), buf, sizeof(buf), true);
+                benchmark::DoNotOptimize(n);
+            }
+        }
+    }
+}
+
+static std::string c_long_path =
+"/static/javascripts/vendor/jquery/dist/../../lodash//lodash.min.js/%E4%BD%A0%E5%A5%BD/index.html";
+
+void BM_NormalizePath(benchmark::State& state)
+{
+    char buf[256];
+    while (state.KeepRunning()) {
+        for (int x = 0; x < state.range(0); ++x) {
+            long n = rapidhttp::NormalizePath(c_long_path.c_str(), c_long_path.size(), buf, sizeof(buf));
+            benchmark::DoNotOptimize(n);
+        }
+    }
+}
+
+// 解析一次有range(0)个域的请求, 每次迭代按不同的大小写查找所有的域
+template <class DocType> void BM_GetField(benchmark::State& state)
+{
+    std::string s = "GET /uri/abc HTTP/1.1\r\n";
+    std::vector<std::string> keys;
+    for (int i = 0; i < state.range(0); ++i) {
+        s += "X-Field-" + std::to_string(i) + ": value\r\n";
+        keys.push_back("x-field-" + std::to_string(i));
+    }
+    s += "\r\n";
+
+    DocType doc(rapidhttp::Request);
+    doc.PartailParse(s);
+    while (state.KeepRunning()) {
+        for (auto const& k : keys)
+            benchmark::DoNotOptimize(doc.GetField(k).size());
+    }
+}
+
+// 按名字和按KnownHeader取常用的头部域
+template <class DocType> void BM_GetKnownField(benchmark::State& state)
+{
+    DocType doc(rapidhttp::Request);
+    doc.PartailParse(c_big_request);
+    bool by_name = state.range(0) == 0;
+    static const std::string host = "Host", cookie = "Cookie", user_agent = "User-Agent";
+    while (state.KeepRunning()) {
+        if (by_name) {
+            benchmark::DoNotOptimize(doc.GetField(host).size());
+            benchmark::DoNotOptimize(doc.GetField(cookie).size());
+            benchmark::DoNotOptimize(doc.GetField(user_agent).size());
+        } else {
+            benchmark::DoNotOptimize(doc.GetField(rapidhttp::KnownHeader::Host).size());
+            benchmark::DoNotOptimize(doc.GetField(rapidhttp::KnownHeader::Cookie).size());
+            benchmark::DoNotOptimize(doc.GetField(rapidhttp::KnownHeader::UserAgent).size());
+        }
+    }
+}
+
 BENCHMARK_TEMPLATE(BM_ParseRequest_0_field, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_1_field, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_2_field, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_3_field, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_big, rapidhttp::HttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_fragmented, rapidhttp::HttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_iovec, CountingHttpDocument)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_iovec, CountingHttpDocumentRef)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_iovec, CountingNativeHttpDocumentRef)->Arg(0)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseResponse, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_PartialParseResponse, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_Serialize, rapidhttp::HttpDocument)->Arg(1);
@@ -181,15 +591,86 @@ BENCHMARK_TEMPLATE(BM_ParseRequest_1_field, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_2_field, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_3_field, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseRequest_big, rapidhttp::HttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_fragmented, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_ParseResponse, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_PartialParseResponse, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_Serialize, rapidhttp::HttpDocumentRef)->Arg(1);
 
+BENCHMARK_TEMPLATE(BM_ParseRequest_0_field, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_1_field, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_2_field, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_3_field, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseResponse, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_PartialParseResponse, rapidhttp::NativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Serialize, rapidhttp::NativeHttpDocument)->Arg(1);
+
+BENCHMARK_TEMPLATE(BM_ParseRequest_0_field, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_1_field, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_2_field, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_3_field, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseResponse, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_PartialParseResponse, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Serialize, rapidhttp::NativeHttpDocumentRef)->Arg(1);
+
+#if USE_PICO
+BENCHMARK_TEMPLATE(BM_ParseRequest_0_field, rapidhttp::PicoHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_1_field, rapidhttp::PicoHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_2_field, rapidhttp::PicoHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_3_field, rapidhttp::PicoHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, rapidhttp::PicoHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseResponse, rapidhttp::PicoHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_PartialParseResponse, rapidhttp::PicoHttpDocument)->Arg(1);
+
+BENCHMARK_TEMPLATE(BM_ParseRequest_0_field, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_1_field, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_2_field, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_3_field, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseResponse, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_PartialParseResponse, rapidhttp::PicoHttpDocumentRef)->Arg(1);
+#endif
+
 BENCHMARK_TEMPLATE(BM_CopyTo, rapidhttp::HttpDocumentRef, rapidhttp::HttpDocument)->Arg(1);
 BENCHMARK_TEMPLATE(BM_CopyTo, rapidhttp::HttpDocumentRef, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_CopyTo, rapidhttp::HttpDocument, rapidhttp::HttpDocumentRef)->Arg(1);
 BENCHMARK_TEMPLATE(BM_CopyTo, rapidhttp::HttpDocument, rapidhttp::HttpDocument)->Arg(1);
 
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, CountingHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_fragmented, CountingHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, CountingHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_fragmented, CountingHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, CountingNativeHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, CountingNativeHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, PoolHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_fragmented, PoolHttpDocument)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_big, PoolHttpDocumentRef)->Arg(1);
+BENCHMARK_TEMPLATE(BM_ParseRequest_fragmented, PoolHttpDocumentRef)->Arg(1);
+
+BENCHMARK_TEMPLATE(BM_KeepAliveStream, CountingHttpDocument)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_KeepAliveStream, CountingHttpDocumentRef)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_KeepAliveStream, CountingNativeHttpDocument)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_KeepAliveStream, CountingNativeHttpDocumentRef)->Arg(0)->Arg(1);
+
+BENCHMARK(BM_DetachRef)->Arg(0)->Arg(1);
+
+BENCHMARK_TEMPLATE(BM_ConstructDocument, rapidhttp::HttpDocument);
+BENCHMARK_TEMPLATE(BM_ConstructDocument, rapidhttp::HttpDocumentRef);
+BENCHMARK_TEMPLATE(BM_ConstructDocument, rapidhttp::NativeHttpDocumentRef);
+BENCHMARK_TEMPLATE(BM_MoveThroughQueue, CountingHttpDocument)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_MoveThroughQueue, CountingHttpDocumentRef)->Arg(0)->Arg(1);
+
+BENCHMARK(BM_QueryNaiveSplit)->Arg(1);
+BENCHMARK(BM_QueryIterator)->Arg(1);
+BENCHMARK(BM_QueryIteratorDecode)->Arg(1);
+BENCHMARK(BM_NormalizePath)->Arg(1);
+
+BENCHMARK_TEMPLATE(BM_GetField, rapidhttp::HttpDocument)->Arg(5)->Arg(20)->Arg(50);
+BENCHMARK_TEMPLATE(BM_GetField, rapidhttp::HttpDocumentRef)->Arg(5)->Arg(20)->Arg(50);
+BENCHMARK_TEMPLATE(BM_GetKnownField, rapidhttp::HttpDocument)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_GetKnownField, rapidhttp::HttpDocumentRef)->Arg(0)->Arg(1);
+
 int main(int argc, char** argv) {
     ::benchmark::Initialize(&argc, argv);
 #if PROFILE
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <memory>
+#include <rapidhttp/constants.h>
+
+namespace rapidhttp {
+
+// 顺序分配(bump-pointer)的内存池, 分配出去的内存不单独释放.
+// Reset后所有分配过的内存失效, 但保留已申请的块, 复用时不再申请内存.
+// 第一次分配时才申请块, 不使用时没有开销.
+// @Alloc: 申请块使用的分配器, 必须可以默认构造
+template <typename Alloc = std::allocator<char>>
+class TArena
+{
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<char> char_alloc_t;
+
+public:
+    explicit TArena(size_t block_size = c_arena_block_size)
+        : head_(nullptr), cur_(nullptr), pos_(nullptr), block_size_(block_size)
+    {}
+
+    TArena(TArena const& other) = delete;
+    TArena& operator=(TArena const& other) = delete;
+
+    // 移动后分配过的内存地址不变, 仍然有效
+    TArena(TArena && other)
+        : head_(other.head_), cur_(other.cur_), pos_(other.pos_), block_size_(other.block_size_)
+    {
+        other.head_ = other.cur_ = nullptr;
+        other.pos_ = nullptr;
+    }
+
+    TArena& operator=(TArena && other)
+    {
+        if (this == &other) return *this;
+
+        Free();
+        head_ = other.head_;
+        cur_ = other.cur_;
+        pos_ = other.pos_;
+        block_size_ = other.block_size_;
+        other.head_ = other.cur_ = nullptr;
+        other.pos_ = nullptr;
+        return *this;
+    }
+
+    ~TArena()
+    {
+        Free();
+    }
+
+    /// 分配n字节, 不对齐(只用于字符串)
+    char* Allocate(size_t n)
+    {
+        if (!cur_ || (size_t)(cur_->End() - pos_) < n)
+            NextBlock(n);
+        char* p = pos_;
+        pos_ += n;
+        return p;
+    }
+
+    /// 原地扩展最后一次分配的内存
+    // @returns: [p, p + old_len)不是最后一次分配的内存, 或者块内空间不足时返回false
+    bool Extend(const char* p, size_t old_len, size_t new_len)
+    {
+        if (!cur_ || p < cur_->Data() || p + old_len != pos_ ||
+                (size_t)(cur_->End() - p) < new_len)
+            return false;
+        pos_ = (char*)p + new_len;
+        return true;
+    }
+
+    /// 是否是从这个Arena分配的内存
+    bool Contains(const char* p) const
+    {
+        for (Block* block = head_; block; block = block->next)
+            if (p >= block->Data() && p < block->End())
+                return true;
+        return false;
+    }
+
+    /// 回收所有分配过的内存, 保留块
+    void Reset()
+    {
+        cur_ = head_;
+        pos_ = head_ ? head_->Data() : nullptr;
+    }
+
+    // 已申请的块数
+    size_t BlockCount() const
+    {
+        size_t count = 0;
+        for (Block* block = head_; block; block = block->next)
+            ++count;
+        return count;
+    }
+
+private:
+    void Free()
+    {
+        char_alloc_t alloc;
+        while (head_) {
+            Block* next = head_->next;
+            alloc.deallocate((char*)head_, sizeof(Block) + head_->size);
+            head_ = next;
+        }
+        cur_ = nullptr;
+        pos_ = nullptr;
+    }
+
+    struct Block
+    {
+        Block* next;
+        size_t size;
+
+        char* Data() { return (char*)(this + 1); }
+        char* End() { return Data() + size; }
+    };
+
+    // 切换到下一个至少有n字节的块, 保留的块不够大时申请一个新块插在当前块的后面.
+    // 新块的大小按2倍增长, 所以连续追加的长字符串(如body)摊还O(1).
+    void NextBlock(size_t n)
+    {
+        Block* next = cur_ ? cur_->next : head_;
+        if (!next || next->size < n) {
+            size_t size = block_size_;
+            while (size < n)
+                size <<= 1;
+            char_alloc_t alloc;
+            Block* block = (Block*)alloc.allocate(sizeof(Block) + size);
+            block->size = size;
+            block->next = next;
+            if (cur_)
+                cur_->next = block;
+            else
+                head_ = block;
+            next = block;
+            block_size_ = size * 2;
+        }
+        cur_ = next;
+        pos_ = cur_->Data();
+    }
+
+private:
+    Block* head_;
+    Block* cur_;
+    char* pos_;
+    size_t block_size_;     // 下一个新块的大小
+};
+
+typedef TArena<> Arena;
+
+} //namespace rapidhttp
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <rapidhttp/constants.h>
+#include <rapidhttp/error_code.h>
+#include <rapidhttp/util.h>
+
+namespace rapidhttp {
+
+// chunked body解码器, NativeBackend和PicoBackend共用.
+// 数据块直接以输入缓冲区的片段回调OnBody, 不拷贝也不缓存; 每个块回调OnChunkHeader/OnChunkComplete.
+// 分隔格式与http-parser一样严格: 长度之后只能是扩展(';'或空白开头)或者CRLF,
+// 数据之后必须恰好是CRLF. trailer域与http-parser一样用OnField写入document的头部域.
+class ChunkedDecoder
+{
+public:
+    inline void Reset()
+    {
+        state_ = cs_size;
+        hex_count_ = 0;
+        remaining_ = 0;
+        has_trailer_ = false;
+        trailer_scan_ = 0;
+        trailer_cache_.clear();
+    }
+
+    // 最后一个块和trailer是否已经解析完成
+    inline bool Done() const
+    {
+        return state_ == cs_done;
+    }
+
+    // 缓存中解析的trailer域引用trailer_cache_, 拷贝或移动之后改为引用新的缓存.
+    // @old_base: 拷贝或移动前的缓存地址
+    template <typename DocT>
+    inline void RebaseCache(DocT * doc, const char* old_base) const
+    {
+        if (!trailer_cache_.empty())
+            doc->Rebase(old_base, trailer_cache_.size(), trailer_cache_.data());
+    }
+
+    inline const char* CacheData() const
+    {
+        return trailer_cache_.data();
+    }
+
+    // @returns: 消费的字节数, 解码完成时停在消息结尾; 出错时回调OnParseError并返回0
+    template <typename DocT>
+    inline size_t Parse(DocT * doc, const char* buf_ref, size_t len)
+    {
+        const char* pos = buf_ref;
+        const char* last = buf_ref + len;
+        while (pos < last) {
+            switch (state_) {
+                case cs_size:
+                    {
+                        // 长度之后的其它字节都是错误, 不能宽松地当作扩展跳过(请求走私)
+                        int v = HexValue(*pos);
+                        if (v < 0) {
+                            if (!hex_count_)
+                                return OnError(doc);
+                            if (*pos == ';' || *pos == ' ' || *pos == '\t') {
+                                state_ = cs_ext;
+                            } else if (*pos == '\r') {
+                                ++pos;
+                                state_ = cs_size_lf;
+                            } else {
+                                return OnError(doc);
+                            }
+                            break;
+                        }
+                        if (++hex_count_ > 16)
+                            return OnError(doc);
+                        remaining_ = remaining_ * 16 + v;
+                        ++pos;
+                    }
+                    break;
+
+                case cs_ext:
+                    for (; pos < last && *pos != '\r'; ++pos)
+                        if (*pos == '\n')
+                            return OnError(doc);
+                    if (pos == last)
+                        return len;
+                    ++pos;
+                    state_ = cs_size_lf;
+                    break;
+
+                case cs_size_lf:
+                    if (*pos++ != '\n')
+                        return OnError(doc);
+                    state_ = remaining_ ? cs_data : cs_trailer;
+                    doc->OnChunkHeader(remaining_);
+                    break;
+
+                case cs_data:
+                    {
+                        size_t n = (size_t)std::min<uint64_t>(remaining_, last - pos);
+                        doc->OnBody(pos, n);
+                        pos += n;
+                        remaining_ -= n;
+                        if (!remaining_)
+                            state_ = cs_data_cr;
+                    }
+                    break;
+
+                // chunk数据之后必须恰好是CRLF
+                case cs_data_cr:
+                    if (*pos++ != '\r')
+                        return OnError(doc);
+                    state_ = cs_data_lf;
+                    break;
+
+                case cs_data_lf:
+                    if (*pos++ != '\n')
+                        return OnError(doc);
+                    state_ = cs_size;
+                    hex_count_ = 0;
+                    doc->OnChunkComplete();
+                    break;
+
+                case cs_trailer:
+                    {
+                        // 出错时返回0, 否则至少消费一个字节
+                        size_t n = ParseTrailer(doc, pos, last - pos);
+                        if (!n)
+                            return 0;
+                        pos += n;
+                        if (state_ == cs_done) {
+                            doc->OnChunkComplete();
+                            return pos - buf_ref;
+                        }
+                    }
+                    break;
+
+                default:
+                    return pos - buf_ref;
+            }
+        }
+        return pos - buf_ref;
+    }
+
+private:
+    enum eChunkedState
+    {
+        cs_size,                // chunk长度
+        cs_ext,                 // chunk扩展, 直到CR
+        cs_size_lf,             // chunk长度行CR之后的LF
+        cs_data,                // chunk数据
+        cs_data_cr,             // chunk数据后的CR
+        cs_data_lf,             // chunk数据后的LF
+        cs_trailer,             // trailer域, 直到空行
+        cs_done,
+    };
+
+    enum eTrailerLine
+    {
+        tl_error,       // 格式错误
+        tl_partial,     // 不完整的行
+        tl_end,         // 结束的空行
+        tl_field,       // trailer域
+    };
+
+    // trailer行在输入中完整时直接引用输入回调OnField; 遇到不完整的行就把剩下的数据缓存起来,
+    // 收到结尾的空行后再从缓存中一次回调, 之后缓存不再改变, 域可以一直引用它.
+    // @returns: 消费的字节数, 出错时回调OnParseError并返回0
+    template <typename DocT>
+    inline size_t ParseTrailer(DocT * doc, const char* buf_ref, size_t len)
+    {
+        const char* pos = buf_ref;
+        const char* last = buf_ref + len;
+        const char* eol = nullptr;
+        const char* next = nullptr;
+        if (trailer_cache_.empty()) {
+            for (;;) {
+                int ret = NextTrailerLine(pos, last, eol, next);
+                if (ret == tl_partial)
+                    break;
+                if (ret == tl_error || (ret == tl_field && !OnTrailerLine(doc, pos, eol)))
+                    return OnError(doc);
+                pos = next;
+                if (ret == tl_end) {
+                    state_ = cs_done;
+                    return pos - buf_ref;
+                }
+            }
+            if (last - pos > (ptrdiff_t)c_max_header_cache_size)
+                return OnError(doc);
+            trailer_cache_.assign(pos, last - pos);
+            trailer_scan_ = 0;
+            return len;
+        }
+
+        // 只检查新收到的完整行, 收到空行之前不回调
+        size_t last_len = trailer_cache_.size();
+        trailer_cache_.append(buf_ref, len);
+        const char* first = trailer_cache_.data();
+        pos = first + trailer_scan_;
+        last = first + trailer_cache_.size();
+        for (;;) {
+            int ret = NextTrailerLine(pos, last, eol, next);
+            if (ret == tl_partial)
+                break;
+            if (ret == tl_error || (ret == tl_field && !OnTrailerLine((DocT*)nullptr, pos, eol)))
+                return OnError(doc);
+            pos = next;
+            if (ret == tl_end) {
+                // 之后的数据属于下一个消息, 缩短不会重新分配内存
+                size_t end = pos - first;
+                trailer_cache_.resize(end);
+                for (pos = first; NextTrailerLine(pos, first + end, eol, next) == tl_field; pos = next)
+                    OnTrailerLine(doc, pos, eol);
+                state_ = cs_done;
+                return end - last_len;
+            }
+        }
+        trailer_scan_ = pos - first;
+        if (trailer_cache_.size() > c_max_header_cache_size)
+            return OnError(doc);
+        return len;
+    }
+
+    // 找到从line开始的一行, 结束的空行与头部块一样接受CRLF或LF, 但CR之后必须是LF.
+    // @eol: trailer域的行尾(不包括CRLF)
+    // @next: 下一行的开头
+    static inline int NextTrailerLine(const char* line, const char* last, const char*& eol, const char*& next)
+    {
+        if (line == last)
+            return tl_partial;
+
+        if (*line == '\r' || *line == '\n') {
+            if (*line == '\r' && ++line == last)
+                return tl_partial;
+            if (*line != '\n')
+                return tl_error;
+            next = line + 1;
+            return tl_end;
+        }
+
+        const char* lf = (const char*)memchr(line, '\n', last - line);
+        if (!lf)
+            return tl_partial;
+        eol = lf[-1] == '\r' ? lf - 1 : lf;
+        next = lf + 1;
+        return tl_field;
+    }
+
+    // 与头部块中的域格式相同, 以空白开头的续行续接到上一个trailer域.
+    // doc为空时只检查格式.
+    template <typename DocT>
+    inline bool OnTrailerLine(DocT * doc, const char* pos, const char* last)
+    {
+        if (memchr(pos, '\r', last - pos))
+            return false;
+
+        const char* k = nullptr;
+        const char* k_last = nullptr;
+        if (*pos == ' ' || *pos == '\t') {
+            if (!has_trailer_)
+                return false;
+        } else {
+            k = pos;
+            while (pos < last && IsTokenChar(*pos))
+                ++pos;
+            if (pos == last || *pos != ':' || pos == k)
+                return false;
+            k_last = pos++;
+        }
+
+        while (pos < last && (*pos == ' ' || *pos == '\t'))
+            ++pos;
+        while (last > pos && (last[-1] == ' ' || last[-1] == '\t'))
+            --last;
+        has_trailer_ = true;
+        if (doc)
+            doc->OnField(k, k_last - k, pos, last - pos);
+        return true;
+    }
+
+    static inline int HexValue(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    template <typename DocT>
+    inline size_t OnError(DocT * doc)
+    {
+        doc->OnParseError(MakeErrorCode(eErrorCode::parse_error));
+        return 0;
+    }
+
+private:
+    int state_ = cs_size;
+    int hex_count_ = 0;
+    bool has_trailer_ = false;      // 已经有trailer域, 可以接受续行
+    uint64_t remaining_ = 0;        // 当前chunk的剩余长度
+    size_t trailer_scan_ = 0;       // trailer_cache_中第一个不完整的行
+    std::string trailer_cache_;     // 跨越输入缓冲区的trailer, 解析完成后域可能引用这里
+};
+
+} //namespace rapidhttp
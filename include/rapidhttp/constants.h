@@ -13,4 +13,22 @@ namespace rapidhttp {
     // 头部域分隔符
     static const char c_field_split = ':';
 
+    // picohttpparser一次最多解析的头部域数量
+    static const size_t c_pico_max_headers = 64;
+
+    // NativeBackend/PicoBackend允许缓存的最大头部(或chunked trailer)长度, 与http-parser的HTTP_MAX_HEADER_SIZE一致
+    static const size_t c_max_header_cache_size = 80 * 1024;
+
+    // 内联存储的头部域数量, 不超过这个数量时解析头部不需要为header_fields_分配内存
+    static const size_t c_inline_header_fields = 16;
+
+    // document的Arena第一个块的大小, 能放下一般请求头部中需要拷贝的数据
+    static const size_t c_arena_block_size = 4096;
+
+    // TDocumentPool每种类型默认最多保留的空闲document数量
+    static const size_t c_document_pool_max_idle = 64;
+
+    // 头部域数量达到这个值时GetField才建立哈希索引, 更少时线性查找更快
+    static const size_t c_field_index_min_fields = 8;
+
 } //namespace rapidhttp
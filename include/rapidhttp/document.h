@@ -3,12 +3,32 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <functional>
+#include <type_traits>
 #include <stdint.h>
+#include <sys/uio.h>
 #include <rapidhttp/constants.h>
+#include <rapidhttp/arena.h>
 #include <rapidhttp/stringref.h>
+#include <rapidhttp/small_vector.h>
+#include <rapidhttp/util.h>
+#include <rapidhttp/url.h>
+#include <rapidhttp/known_header.h>
 #include <rapidhttp/error_code.h>
-#include <rapidhttp/layer.hpp>
+#include <rapidhttp/http_parser_backend.h>
+#include <rapidhttp/native_backend.h>
 #include "cmake_config.h"
+#if USE_PICO
+#include <rapidhttp/pico_backend.h>
+#endif
+
+// C++17编译时支持THttpDocument<std::string_view>
+#if __cplusplus >= 201703L
+#include <string_view>
+#define RAPIDHTTP_HAS_STRING_VIEW 1
+#else
+#define RAPIDHTTP_HAS_STRING_VIEW 0
+#endif
 
 namespace rapidhttp {
 
@@ -18,21 +38,130 @@ enum DocumentType
     Response,
 };
 
+// 只引用数据的字符串类型: 不能原地修改, 也没有可以复用的容量
+template <typename S>
+struct IsRefString : std::is_same<S, StringRef> {};
+#if RAPIDHTTP_HAS_STRING_VIEW
+template <>
+struct IsRefString<std::string_view> : std::true_type {};
+#endif
+
+// chunked body中的一个块
+struct ChunkInfo
+{
+    uint64_t size;              // chunk-size, 结尾的0长度块也会记录
+    size_t fragment_index;      // 块数据在body片段列表中的起始下标
+    size_t fragment_count;      // 块数据占用的片段数
+};
+
+// GetFields返回的同名头部域的值, 可以用于range-based for
+// 引用document的头部域, 遍历期间不能修改document的头部域.
+template <typename Fields>
+class TFieldRange
+{
+public:
+    typedef typename Fields::value_type::second_type string_t;
+
+    class iterator
+    {
+    public:
+        iterator(TFieldRange const* range, size_t index)
+            : range_(range), index_(index)
+        {
+            Skip();
+        }
+
+        string_t const& operator*() const
+        {
+            return (*range_->fields_)[index_].second;
+        }
+
+        iterator& operator++()
+        {
+            ++index_;
+            Skip();
+            return *this;
+        }
+
+        bool operator==(iterator const& other) const { return index_ == other.index_; }
+        bool operator!=(iterator const& other) const { return index_ != other.index_; }
+
+    private:
+        // 跳到下一个同名的域, 删除的域名字为空, 不会匹配
+        void Skip()
+        {
+            Fields const& fields = *range_->fields_;
+            for (; index_ < fields.size(); ++index_) {
+                auto const& name = fields[index_].first;
+                if (CaseInsensitiveEqual(name.data(), name.size(),
+                            range_->name_.c_str(), range_->name_.size()))
+                    break;
+            }
+        }
+
+        TFieldRange const* range_;
+        size_t index_;
+    };
+
+    TFieldRange(Fields const& fields, std::string const& name)
+        : fields_(&fields), name_(name)
+    {}
+
+    iterator begin() const { return iterator(this, name_.empty() ? fields_->size() : 0); }
+    iterator end() const { return iterator(this, fields_->size()); }
+
+private:
+    Fields const* fields_;
+    std::string name_;      // 拷贝一份, 允许传入临时的字符串
+};
+
 // Http Header document class.
-template <typename StringT>
+// @StringT: 字段的存储类型, std::string或StringRef
+// @Backend: 解析引擎, HttpParserBackend, NativeBackend或PicoBackend(USE_PICO)
+// @Alloc: header_fields_, 其他容器和arena_使用的分配器, 必须可以默认构造(无状态).
+//         std::string字段要使用这个分配器时, StringT用std::basic_string<char, std::char_traits<char>, Alloc>
+template <typename StringT, typename Backend = HttpParserBackend, typename Alloc = std::allocator<char>>
 class THttpDocument
 {
 public:
     typedef StringT string_t;
+    typedef Backend backend_t;
+    typedef Alloc allocator_type;
+
+    template <typename T>
+    using rebind_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+    template <typename T>
+    using vector_t = std::vector<T, rebind_alloc_t<T>>;
+
+    // body接收器: 按顺序接收解析到的body片段
+    typedef std::function<void(const char* at, size_t length)> BodySink;
 
     explicit THttpDocument(DocumentType type);
     THttpDocument(THttpDocument const& other) = delete;
-    THttpDocument(THttpDocument && other) = delete;
     THttpDocument& operator=(THttpDocument const& other) = delete;
-    THttpDocument& operator=(THttpDocument && other) = delete;
 
-    template <typename OStringT>
-    void CopyTo(THttpDocument<OStringT> & clone) const;
+    /// 移动
+    // 解析状态一起转移, 可以在解析到一半时移动, 之后用新的document继续解析.
+    // 引用输入缓冲区的字段仍然引用输入缓冲区, 拷贝到arena中的数据地址不变.
+    // 被移动的document处于Reset后的状态.
+    inline THttpDocument(THttpDocument && other);
+    inline THttpDocument& operator=(THttpDocument && other);
+
+    template <typename OStringT, typename OAlloc>
+    void CopyTo(THttpDocument<OStringT, Backend, OAlloc> & clone) const;
+
+    /// 不再引用输入缓冲区
+    // HttpDocumentRef的字段默认引用输入缓冲区, Freeze把它们一次性拷贝到arena中一块连续的内存里,
+    // 最多申请一次内存, 之后输入缓冲区可以释放或复用. 数据在下一个消息开始(Reset/继续解析)前有效.
+    // 保存了body时, GetBodyFragments()也改为指向document中的body.
+    // 字段是std::string时本来就拥有数据, 只需要处理body片段.
+    inline void Freeze();
+
+    /// 输入缓冲区移动后修正引用
+    // 读缓冲区整理(memmove)或扩容(realloc)后调用, 解析到一半的document不需要拷贝字段.
+    // 引用[old_base, old_base + len)中数据的字段和body片段改为引用new_base中相同偏移处的数据,
+    // 拷贝到arena中或拥有数据的字段不变. 之后继续用新的缓冲区解析.
+    inline void Rebase(const char* old_base, size_t len, const char* new_base);
 
     /// ------------------- parse/generate ---------------------
     /// 流式解析
@@ -42,6 +171,59 @@ public:
     inline size_t PartailParse(const char* buf_ref, size_t len);
     inline size_t PartailParse(std::string const& buf);
 
+    /// 流式解析分散在多段缓冲区中的输入(readv, 环形缓冲区)
+    // 与依次对每一段调用PartailParse相同, 所以拷贝多少数据取决于解析引擎:
+    //   HttpParserBackend: 完整地在一段内的字段直接引用输入, 只有跨越两段的字段才拷贝到arena中.
+    //   NativeBackend/PicoBackend: 头部块跨越两段时, 整个头部块拷贝到解析引擎的缓存中再解析,
+    //     比先拷贝到一块线性缓冲区再解析更慢; 头部块在一段内时不拷贝.
+    // body片段总是直接引用输入.
+    // 解析完一个消息, 出错或在头部结尾暂停时停止, 不会开始解析下一个消息.
+    // @iov, @iovcnt: 按顺序排列的输入段
+    // @returns：返回已成功解析到的数据总长度
+    inline size_t PartailParse(const struct iovec* iov, size_t iovcnt);
+
+    /// 解析缓冲区中所有的消息(pipeline)
+    // 每次PartailParse都恰好停在一个消息的结尾, ParseAll循环解析, 每解析完成一个消息
+    // 就调用一次cb(*this), cb返回后document会被重置用于解析下一个消息.
+    // 末尾不完整的消息保留在document中, 下次调用PartailParse/ParseAll时继续解析.
+    // @cb: void(THttpDocument &)
+    // @returns：返回已成功解析到的数据长度, 解析出错时停在出错的消息处.
+    template <typename F>
+    inline size_t ParseAll(const char* buf_ref, size_t len, F && cb);
+    template <typename F>
+    inline size_t ParseAll(const struct iovec* iov, size_t iovcnt, F && cb);
+
+    /// 设置body接收器, 用于流式处理body(上传/代理)
+    // 片段引用的是输入缓冲区, 只在回调期间有效. chunked body每个块的数据到达时就回调.
+    // Reset不会清除接收器.
+    // @sink: 为空时不回调
+    // @store_body: 是否仍然把body保存到document中(GetBody),
+    //              不保存时内存占用与body大小无关.
+    inline void SetBodySink(BodySink const& sink, bool store_body = false);
+
+    /// 记录body片段和chunked块信息, 默认不记录
+    // 片段是引用输入缓冲区的(pointer, length)列表, 与struct iovec兼容, 可以直接writev.
+    // 所有的解析引擎都会记录块信息(NativeBackend和PicoBackend由ChunkedDecoder解码).
+    // 和HttpDocumentRef一样, 使用片段期间必须保证输入缓冲区有效且不变.
+    inline void SetRecordBodyFragments(bool record);
+    inline vector_t<struct iovec> const& GetBodyFragments();
+    inline vector_t<ChunkInfo> const& GetChunks();
+
+    /// 解析到头部结尾时暂停, 默认不暂停
+    // 开启后PartailParse解析完头部就返回, 返回值恰好是body第一个字节在本次输入中的偏移,
+    // 此时HeadersDone()为true, ParseDone()为false(没有body的消息两者都为true).
+    // 需要body时对剩余数据继续调用PartailParse即可, 否则可以由调用者直接转发剩余数据.
+    inline void SetPauseAtHeaders(bool pause);
+
+    /// 头部是否解析完成
+    inline bool HeadersDone();
+
+    /// 是否是Upgrade(如WebSocket)或CONNECT消息
+    // 解析会停在这个消息的结尾(ParseDone), PartailParse/ParseAll的返回值恰好是第一个
+    // 隧道数据字节在输入中的偏移, 剩余的数据可以直接交给其他协议处理.
+    // 之后的数据不再按http解析, 复用document时要先调用Reset().
+    inline bool IsUpgrade();
+
     /// 解析eof 
     // 解析Response时, 断开链接时要调用这个接口, 因为有些response协议需要读取到
     // 网络链接断开为止.
@@ -77,6 +259,19 @@ public:
     inline void SetUri(const char* m);
     inline void SetUri(std::string const& m);
 
+    // uri分解后的各部分, 第一次调用时才分解并缓存, 引用的是GetUri()的数据
+    inline UrlView const& GetUrl();
+
+    /// 规范化uri的path部分(percent解码, 移除"."和".."段, 合并连续的'/'), query和fragment不变
+    // 原地修改, 只能用于HttpDocument(std::string)
+    // @returns: 是否成功, 失败时uri不变
+    inline bool NormalizeUri();
+
+    // 把规范化后的uri写入buf并让uri引用buf, 不修改输入缓冲区, 用于HttpDocumentRef,
+    // 使用期间必须保证buf有效且不变. buf的长度不小于GetUri().size()时一定够用.
+    // @returns: 规范化后的uri长度, 失败或buf空间不足时返回-1, 失败时uri不变
+    inline long NormalizeUri(char* buf, size_t len);
+
     inline string_t const& GetStatus();
     inline void SetStatus(const char* m);
     inline void SetStatus(std::string const& m);
@@ -90,10 +285,31 @@ public:
     inline int GetMinor();
     inline void SetMinor(int v);
 
+    // 头部域名忽略大小写, 有多个同名域时返回第一个.
+    // 域较多时第一次查找会建立哈希索引, 之后的查找是O(1)的.
     inline string_t const& GetField(std::string const& k);
     inline void SetField(std::string const& k, const char* m);
     inline void SetField(std::string const& k, std::string const& m);
 
+    typedef SmallVector<std::pair<string_t, string_t>, c_inline_header_fields,
+            rebind_alloc_t<std::pair<string_t, string_t>>> fields_t;
+    typedef TFieldRange<fields_t> field_range_t;
+
+    // 追加一个域, 不检查是否已有同名的域(Set-Cookie, Via等)
+    inline void AddField(std::string const& k, const char* m);
+    inline void AddField(std::string const& k, std::string const& m);
+
+    // 所有同名域的值, 按出现的顺序
+    inline field_range_t GetFields(std::string const& k);
+
+    // 删除所有同名的域, 只把域标记为已删除(名字置空), 不移动其他的域.
+    // 序列化时跳过已删除的域.
+    // @returns: 删除的域的数量
+    inline size_t RemoveField(std::string const& k);
+
+    // 常用的头部域在解析时已经记录了位置, 直接按下标取值, 有多个同名域时返回第一个
+    inline string_t const& GetField(KnownHeader h);
+
     inline string_t const& GetBody();
     inline void SetBody(const char* m);
     inline void SetBody(std::string const& m);
@@ -109,59 +325,167 @@ private:
     inline bool CheckStatus() const;
     inline bool CheckVersion() const;
 
-#if USE_PICO
-#else
-    // http-parser
-private:
-    static inline int sOnHeadersComplete(http_parser *parser);
-    static inline int sOnMessageComplete(http_parser *parser);
-    static inline int sOnUrl(http_parser *parser, const char *at, size_t length);
-    static inline int sOnStatus(http_parser *parser, const char *at, size_t length);
-    static inline int sOnHeaderField(http_parser *parser, const char *at, size_t length);
-    static inline int sOnHeaderValue(http_parser *parser, const char *at, size_t length);
-    static inline int sOnBody(http_parser *parser, const char *at, size_t length);
-
-    inline int OnHeadersComplete(http_parser *parser);
-    inline int OnMessageComplete(http_parser *parser);
-    inline int OnUrl(http_parser *parser, const char *at, size_t length);
-    inline int OnStatus(http_parser *parser, const char *at, size_t length);
-    inline int OnHeaderField(http_parser *parser, const char *at, size_t length);
-    inline int OnHeaderValue(http_parser *parser, const char *at, size_t length);
-    inline int OnBody(http_parser *parser, const char *at, size_t length);
+    // 查找头部域, 返回header_fields_中的下标, 没有时返回-1
+    inline long FindField(const char* k, size_t k_len);
+    inline void UpdateFieldIndex();
+    inline void ClearFieldIndex();
+    // header_fields_追加了一个域后调用, 记录常用头部域的位置
+    inline void OnFieldAppended();
+
+    // 追加一个空的头部域, 优先使用回收的域
+    inline std::pair<string_t, string_t> & NewField();
+    // 正在解析的头部域完整了, 记录它的位置
+    inline void FinishField();
+    // 清除头部域, std::string的域回收到spare_fields_中, 下一个消息复用它们的容量
+    inline void RecycleFields();
+
+    // 赋值解析到的数据, StringRef引用输入
+    template <typename S>
+    inline void Assign(S & s, const char* at, size_t length);
+    inline void Assign(StringRef & s, const char* at, size_t length);
+#if RAPIDHTTP_HAS_STRING_VIEW
+    inline void Assign(std::string_view & s, const char* at, size_t length);
 #endif
 
+    // 追加解析到的数据, StringRef不连续时拷贝到arena_中
+    template <typename S>
+    inline void Append(S & s, const char* at, size_t length);
+    inline void Append(StringRef & s, const char* at, size_t length);
+#if RAPIDHTTP_HAS_STRING_VIEW
+    // std::string_view不连续时拷贝到arena_中
+    inline void Append(std::string_view & s, const char* at, size_t length);
+#endif
+
+    // 清空字段, std::string保留容量
+    template <typename S>
+    inline void Clear(S & s);
+#if RAPIDHTTP_HAS_STRING_VIEW
+    inline void Clear(std::string_view & s);
+#endif
+
+    // Freeze时调用: 统计需要拷贝的长度, 拷贝到pos处并引用它
+    template <typename S>
+    inline size_t FrozenSize(S const& s) const;
+    inline size_t FrozenSize(StringRef const& s) const;
+#if RAPIDHTTP_HAS_STRING_VIEW
+    inline size_t FrozenSize(std::string_view const& s) const;
+#endif
+    template <typename S>
+    inline void FreezeString(S & s, char* & pos);
+    inline void FreezeString(StringRef & s, char* & pos);
+#if RAPIDHTTP_HAS_STRING_VIEW
+    inline void FreezeString(std::string_view & s, char* & pos);
+#endif
+
+    // Rebase时调用, 只有StringRef需要修正
+    template <typename S>
+    inline void RebaseString(S & s, const char* old_base, size_t len, const char* new_base);
+    inline void RebaseString(StringRef & s, const char* old_base, size_t len, const char* new_base);
+#if RAPIDHTTP_HAS_STRING_VIEW
+    inline void RebaseString(std::string_view & s, const char* old_base, size_t len, const char* new_base);
+#endif
+
+    // CopyTo时调用: 引用src_arena中数据的StringRef要拷贝到自己的arena_中
+    template <typename S, typename ArenaT>
+    inline void AdoptString(S & s, ArenaT const& src_arena);
+    template <typename ArenaT>
+    inline void AdoptString(StringRef & s, ArenaT const& src_arena);
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename ArenaT>
+    inline void AdoptString(std::string_view & s, ArenaT const& src_arena);
+#endif
+
+    /// ------------------- parse events -----------------------
+    // 由Backend在解析过程中调用, 把解析到的数据写入document
+    // 开始解析一个新的消息, 清除已解析的数据
+    inline int OnMessageBegin();
+    inline int OnMethod(const char *at, size_t length);
+    inline int OnUrl(const char *at, size_t length);
+    inline int OnStatus(const char *at, size_t length);
+    // 流式的头部域, 一个域可能分多次回调
+    inline int OnHeaderField(const char *at, size_t length);
+    inline int OnHeaderValue(const char *at, size_t length);
+    // 完整的头部域, k为nullptr时表示续接到上一个域的值
+    inline int OnField(const char *k, size_t k_len, const char *v, size_t v_len);
+    inline int OnHeadersComplete();
+    inline int OnBody(const char *at, size_t length);
+    // chunked body的块头(chunk-size已解析)和块结束
+    inline int OnChunkHeader(uint64_t size);
+    inline int OnChunkComplete();
+    inline int OnMessageComplete();
+    inline void OnParseError(std::error_code const& ec);
+    // 头部表明这是一个Upgrade/CONNECT消息, 在OnHeadersComplete之前调用
+    inline void OnUpgrade();
+    /// --------------------------------------------------------
+
 private:
+    // 标志和小的整数放在最前面, 避免在大的成员之间产生对齐填充
     DocumentType type_;     // 类型
 
+    bool headers_done_ = false;
     bool parse_done_ = false;
-    std::error_code ec_;    // 解析错状态
-
-#if USE_PICO
-#else
-    struct http_parser parser_;
-    struct http_parser_settings settings_;
-#endif
+    bool upgrade_ = false;
+    bool url_parsed_ = false;
+    bool pause_at_headers_ = false;
+    bool store_body_ = true;
+    bool record_body_fragments_ = false;
 
-    int kv_state_ = 0;
-    string_t callback_header_key_cache_;
-    string_t callback_header_value_cache_;
+    // 流式解析头部域的状态: 0 不在域中, 1 正在解析域名, 2 正在解析域值.
+    // 正在解析的域直接追加在header_fields_的最后, 完整后才记录到索引中
+    uint8_t kv_state_ = 0;
 
     // 默认版本号: HTTP/1.1
     uint32_t major_ = 1;
     uint32_t minor_ = 1;
+    uint32_t response_status_code_ = 0;
+
+    // 头部域名的哈希索引只索引了header_fields_的前field_indexed_个域
+    uint32_t field_indexed_ = 0;
+
+    // 常用头部域第一次出现的位置: header_fields_中的下标+1, 0表示没有.
+    // 下标超过uint16_t的域不记录, 只能按名字查找
+    uint16_t known_fields_[c_known_header_count] = {};
+
+    std::error_code ec_;    // 解析错状态
+
+    Backend backend_;      // 解析引擎
+
+    // 数据分散在多次输入中时, HttpDocumentRef的字段拷贝到这里. 新消息开始时回收, 保留内存
+    TArena<Alloc> arena_;
 
     string_t request_method_;
     string_t request_uri_;
+    UrlView url_;
 
-    uint32_t response_status_code_ = 0;
     string_t response_status_;
 
-    std::vector<std::pair<string_t, string_t>> header_fields_;
+    // 删除的域名字为空
+    fields_t header_fields_;
+
+    // 上一个消息回收的头部域(只用于std::string)
+    vector_t<std::pair<string_t, string_t>> spare_fields_;
+
+    // 头部域名的哈希索引(开放寻址).
+    // 域只会追加, 所以查找时把新增的域补进索引即可.
+    struct FieldSlot
+    {
+        uint32_t hash;
+        uint32_t index;     // header_fields_中的下标+1, 0表示空
+    };
+    vector_t<FieldSlot> field_index_;
 
     string_t body_;
 
-    template <typename T>
+    BodySink body_sink_;
+
+    vector_t<struct iovec> body_fragments_;
+    vector_t<ChunkInfo> chunks_;
+
+    template <typename T, typename B, typename A>
     friend class THttpDocument;
+
+    friend Backend;
+    friend class ChunkedDecoder;
 };
 
 } //namespace rapidhttp 
@@ -2,233 +2,520 @@
 #include "document.h"
 #include <rapidhttp/util.h>
 #include <algorithm>
+#include <limits>
 #include <stdio.h>
 
 namespace rapidhttp {
 
-    template <typename StringT>
-    inline THttpDocument<StringT>::THttpDocument(DocumentType type)
+    // 不同字符串类型之间赋值, StringRef/std::string_view引用源字符串的数据
+    template <typename D, typename S>
+    inline void AssignString(D & dst, S const& src)
+    {
+        dst = D(src.data(), src.size());
+    }
+    template <typename T>
+    inline void AssignString(T & dst, T const& src)
+    {
+        dst = src;
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline THttpDocument<StringT, Backend, Alloc>::THttpDocument(DocumentType type)
         : type_(type)
     {
+        backend_.Init(this);
         Reset();
-#if USE_PICO
-#else
-        memset(&settings_, 0, sizeof(settings_));
-        settings_.on_headers_complete = sOnHeadersComplete;
-        settings_.on_message_complete = sOnMessageComplete;
-        settings_.on_url = sOnUrl;
-        settings_.on_status = sOnStatus;
-        settings_.on_header_field = sOnHeaderField;
-        settings_.on_header_value = sOnHeaderValue;
-        settings_.on_body = sOnBody;
-#endif
     }
 
-    template <typename StringT>
-    template <typename OStringT>
-    void THttpDocument<StringT>::CopyTo(THttpDocument<OStringT> & clone) const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline THttpDocument<StringT, Backend, Alloc>::THttpDocument(THttpDocument && other)
+        : type_(other.type_), headers_done_(other.headers_done_), parse_done_(other.parse_done_),
+        upgrade_(other.upgrade_), url_parsed_(false),
+        pause_at_headers_(other.pause_at_headers_), store_body_(other.store_body_),
+        record_body_fragments_(other.record_body_fragments_),
+        kv_state_(other.kv_state_),
+        major_(other.major_), minor_(other.minor_),
+        response_status_code_(other.response_status_code_),
+        field_indexed_(other.field_indexed_),
+        ec_(other.ec_),
+        arena_(std::move(other.arena_)),
+        request_method_(std::move(other.request_method_)),
+        request_uri_(std::move(other.request_uri_)),
+        response_status_(std::move(other.response_status_)),
+        header_fields_(std::move(other.header_fields_)),
+        spare_fields_(std::move(other.spare_fields_)),
+        field_index_(std::move(other.field_index_)),
+        body_(std::move(other.body_)),
+        body_sink_(std::move(other.body_sink_)),
+        body_fragments_(std::move(other.body_fragments_)),
+        chunks_(std::move(other.chunks_))
+    {
+        // 不需要像构造函数那样Reset, 直接接管other的状态
+        other.backend_.MoveTo(backend_, this);
+        std::copy(std::begin(other.known_fields_), std::end(other.known_fields_), std::begin(known_fields_));
+        other.field_indexed_ = 0;
+        other.Reset();
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline THttpDocument<StringT, Backend, Alloc>&
+    THttpDocument<StringT, Backend, Alloc>::operator=(THttpDocument && other)
+    {
+        if (this == &other) return *this;
+
+#define _MOVE_FROM(param) \
+        this->param = std::move(other.param)
+
+        _MOVE_FROM(type_);
+        _MOVE_FROM(headers_done_);
+        _MOVE_FROM(parse_done_);
+        _MOVE_FROM(upgrade_);
+        _MOVE_FROM(ec_);
+        _MOVE_FROM(arena_);
+        _MOVE_FROM(kv_state_);
+        _MOVE_FROM(major_);
+        _MOVE_FROM(minor_);
+        _MOVE_FROM(request_method_);
+        _MOVE_FROM(request_uri_);
+        url_parsed_ = false;    // url_引用的是other.request_uri_, std::string移动后地址可能改变
+        _MOVE_FROM(response_status_code_);
+        _MOVE_FROM(response_status_);
+        _MOVE_FROM(header_fields_);
+        _MOVE_FROM(spare_fields_);
+        _MOVE_FROM(field_index_);
+        _MOVE_FROM(field_indexed_);
+        std::copy(std::begin(other.known_fields_), std::end(other.known_fields_), std::begin(known_fields_));
+        _MOVE_FROM(body_);
+        _MOVE_FROM(pause_at_headers_);
+        _MOVE_FROM(body_sink_);
+        _MOVE_FROM(store_body_);
+        _MOVE_FROM(record_body_fragments_);
+        _MOVE_FROM(body_fragments_);
+        _MOVE_FROM(chunks_);
+        // parser_.data指向document, 要改为指向this; 引用解析引擎缓存的字段已经移动过来, 一起修正
+        other.backend_.MoveTo(backend_, this);
+
+#undef _MOVE_FROM
+
+        other.field_indexed_ = 0;
+        other.Reset();
+        return *this;
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename OStringT, typename OAlloc>
+    void THttpDocument<StringT, Backend, Alloc>::CopyTo(THttpDocument<OStringT, Backend, OAlloc> & clone) const
     {
 #define _COPY_TO(param) \
         clone.param = this->param
 
+#define _COPY_STRING(param) \
+        AssignString(clone.param, this->param)
+
+#define _COPY_VECTOR(param) \
+        clone.param.assign(this->param.begin(), this->param.end())
+
+        clone.arena_.Reset();
         _COPY_TO(type_);
+        _COPY_TO(headers_done_);
         _COPY_TO(parse_done_);
+        _COPY_TO(upgrade_);
         _COPY_TO(ec_);
-        _COPY_TO(parser_);
-        clone.parser_.data = &clone;
         _COPY_TO(kv_state_);
-        _COPY_TO(callback_header_key_cache_);
-        _COPY_TO(callback_header_value_cache_);
         _COPY_TO(major_);
         _COPY_TO(minor_);
-        _COPY_TO(request_method_);
-        _COPY_TO(request_uri_);
+        _COPY_STRING(request_method_);
+        _COPY_STRING(request_uri_);
+        clone.url_parsed_ = false;  // url_引用的是各自的uri, 不能拷贝
         _COPY_TO(response_status_code_);
-        _COPY_TO(response_status_);
-        _COPY_TO(body_);
+        _COPY_STRING(response_status_);
+        _COPY_STRING(body_);
+        _COPY_TO(body_sink_);
+        _COPY_TO(pause_at_headers_);
+        _COPY_TO(store_body_);
+        _COPY_TO(record_body_fragments_);
+        _COPY_VECTOR(body_fragments_);
+        _COPY_VECTOR(chunks_);
 
+        clone.ClearFieldIndex();
+        std::copy(std::begin(known_fields_), std::end(known_fields_), std::begin(clone.known_fields_));
         clone.header_fields_.clear();
         clone.header_fields_.reserve(this->header_fields_.size());
         for (auto const& kv : this->header_fields_)
         {
-            clone.header_fields_.emplace_back(std::pair<OStringT, OStringT>(
-                        (OStringT)kv.first, (OStringT)kv.second));
+            clone.header_fields_.emplace_back();
+            AssignString(clone.header_fields_.back().first, kv.first);
+            AssignString(clone.header_fields_.back().second, kv.second);
+        }
+
+        // 引用this->arena_的字段拷贝到clone.arena_中
+        clone.AdoptString(clone.request_method_, arena_);
+        clone.AdoptString(clone.request_uri_, arena_);
+        clone.AdoptString(clone.response_status_, arena_);
+        clone.AdoptString(clone.body_, arena_);
+        for (auto & kv : clone.header_fields_) {
+            clone.AdoptString(kv.first, arena_);
+            clone.AdoptString(kv.second, arena_);
         }
 
+        // 字段都拷贝完后再拷贝解析引擎, 引用解析引擎缓存的字段要改为引用clone的缓存
+        backend_.CopyTo(clone.backend_, &clone);
+
+#undef _COPY_VECTOR
+#undef _COPY_STRING
 #undef _COPY_TO
     }
 
-    /// ------------------- parse/generate ---------------------
-    /// 流式解析
-    // @buf_ref: 外部传入的缓冲区首地址, 再调用Storage前必须保证缓冲区有效且不变.
-    // @len: 缓冲区长度
-    // @returns：解析完成返回error_code=0, 解析一半返回error_code=1, 解析失败返回其他错误码.
-    template <typename StringT>
-    inline size_t THttpDocument<StringT>::PartailParse(std::string const& buf)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Freeze()
+    {
+        size_t bytes = FrozenSize(request_method_) + FrozenSize(request_uri_) +
+            FrozenSize(response_status_) + FrozenSize(body_);
+        for (auto const& kv : header_fields_)
+            bytes += FrozenSize(kv.first) + FrozenSize(kv.second);
+        if (bytes) {
+            char* pos = arena_.Allocate(bytes);
+            FreezeString(request_method_, pos);
+            FreezeString(request_uri_, pos);
+            url_parsed_ = false;
+            FreezeString(response_status_, pos);
+            for (auto & kv : header_fields_) {
+                FreezeString(kv.first, pos);
+                FreezeString(kv.second, pos);
+            }
+            FreezeString(body_, pos);
+        }
+
+        // body是按片段的顺序追加的, 片段在body中依次排列
+        size_t total = 0;
+        for (auto const& iov : body_fragments_)
+            total += iov.iov_len;
+        if (total && total == body_.size()) {
+            size_t offset = 0;
+            for (auto & iov : body_fragments_) {
+                iov.iov_base = (void*)(body_.data() + offset);
+                offset += iov.iov_len;
+            }
+        }
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Rebase(const char* old_base, size_t len, const char* new_base)
+    {
+        RebaseString(request_method_, old_base, len, new_base);
+        RebaseString(request_uri_, old_base, len, new_base);
+        url_parsed_ = false;
+        RebaseString(response_status_, old_base, len, new_base);
+        for (auto & kv : header_fields_) {
+            RebaseString(kv.first, old_base, len, new_base);
+            RebaseString(kv.second, old_base, len, new_base);
+        }
+        RebaseString(body_, old_base, len, new_base);
+
+        for (auto & iov : body_fragments_) {
+            const char* base = (const char*)iov.iov_base;
+            if (base >= old_base && base + iov.iov_len <= old_base + len)
+                iov.iov_base = (void*)(new_base + (base - old_base));
+        }
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::PartailParse(std::string const& buf)
     {
         return PartailParse(buf.c_str(), buf.size());
     }
 
-#if USE_PICO
-#else
-    template <typename StringT>
-    inline size_t THttpDocument<StringT>::PartailParse(const char* buf_ref, size_t len)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::PartailParse(const char* buf_ref, size_t len)
     {
+        if (ParseDone() && IsUpgrade())
+            return 0;
+
         if (ParseDone() || ParseError())
             Reset();
 
-        size_t parsed = http_parser_execute(&parser_, &settings_, buf_ref, len);
-        if (parser_.http_errno) {
-            // TODO: support pause
-            ec_ = MakeParseErrorCode(parser_.http_errno);
+        return backend_.PartailParse(this, buf_ref, len);
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::PartailParse(const struct iovec* iov, size_t iovcnt)
+    {
+        // 上一个消息已经结束时, 本次解析从新的消息开始
+        bool pause = pause_at_headers_ && (!headers_done_ || ParseDone() || ParseError());
+        size_t parsed = 0;
+        for (size_t i = 0; i < iovcnt; ++i) {
+            size_t len = iov[i].iov_len;
+            if (!len) continue;
+
+            // 上一段恰好结束了一个消息, 不能重置document开始解析下一个
+            if (parsed && (ParseDone() || ParseError() || (pause && headers_done_)))
+                break;
+
+            size_t bytes = PartailParse((const char*)iov[i].iov_base, len);
+            parsed += bytes;
+            if (bytes < len)
+                break;
         }
         return parsed;
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::PartailParseEof()
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename F>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::ParseAll(const char* buf_ref, size_t len, F && cb)
     {
-        if (ParseDone() || ParseError())
-            return false;
+        size_t parsed = 0;
+        while (parsed < len) {
+            size_t bytes = PartailParse(buf_ref + parsed, len - parsed);
+            parsed += bytes;
+            if (ParseError())
+                break;
 
-        PartailParse("", 0);
-        return ParseDone();
+            if (!ParseDone()) {
+                if (!bytes) break;
+                continue;
+            }
+
+            cb(*this);
+            if (IsUpgrade())
+                break;
+        }
+        return parsed;
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::ParseDone()
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename F>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::ParseAll(const struct iovec* iov, size_t iovcnt, F && cb)
     {
-        return parse_done_;
+        // 每一段都按pipeline解析, 段末尾不完整的消息在下一段中继续
+        size_t parsed = 0;
+        for (size_t i = 0; i < iovcnt; ++i) {
+            size_t len = iov[i].iov_len;
+            size_t bytes = ParseAll((const char*)iov[i].iov_base, len, cb);
+            parsed += bytes;
+            if (bytes < len || ParseError() || (ParseDone() && IsUpgrade()))
+                break;
+        }
+        return parsed;
     }
-
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnHeadersComplete(http_parser *parser)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetPauseAtHeaders(bool pause)
     {
-        return ((THttpDocument*)parser->data)->OnHeadersComplete(parser);
+        pause_at_headers_ = pause;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnMessageComplete(http_parser *parser)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::HeadersDone()
     {
-        return ((THttpDocument*)parser->data)->OnMessageComplete(parser);
+        return headers_done_;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnUrl(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetBodySink(BodySink const& sink, bool store_body)
     {
-        return ((THttpDocument*)parser->data)->OnUrl(parser, at, length);
+        body_sink_ = sink;
+        store_body_ = store_body;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnStatus(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetRecordBodyFragments(bool record)
     {
-        return ((THttpDocument*)parser->data)->OnStatus(parser, at, length);
+        record_body_fragments_ = record;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnHeaderField(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline typename THttpDocument<StringT, Backend, Alloc>::template vector_t<struct iovec> const&
+    THttpDocument<StringT, Backend, Alloc>::GetBodyFragments()
     {
-        return ((THttpDocument*)parser->data)->OnHeaderField(parser, at, length);
+        return body_fragments_;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnHeaderValue(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline typename THttpDocument<StringT, Backend, Alloc>::template vector_t<ChunkInfo> const&
+    THttpDocument<StringT, Backend, Alloc>::GetChunks()
     {
-        return ((THttpDocument*)parser->data)->OnHeaderValue(parser, at, length);
+        return chunks_;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::sOnBody(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::IsUpgrade()
     {
-        return ((THttpDocument*)parser->data)->OnBody(parser, at, length);
+        return upgrade_;
     }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::PartailParseEof()
+    {
+        if (ParseDone() || ParseError())
+            return false;
 
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnHeadersComplete(http_parser *parser)
+        return backend_.PartailParseEof(this);
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnMethod(const char *at, size_t length)
     {
-        if (IsRequest())
-            request_method_ = http_method_str((http_method)parser->method);
-        else
-            response_status_code_ = parser->status_code;
-        major_ = parser->http_major;
-        minor_ = parser->http_minor;
-        if (kv_state_ == 1) {
-            header_fields_.emplace_back(std::move(callback_header_key_cache_),
-                    std::move(callback_header_value_cache_));
-            kv_state_ = 0;
-        }
+        Append(request_method_, at, length);
         return 0;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnMessageComplete(http_parser *parser)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnUrl(const char *at, size_t length)
     {
-        parse_done_ = true;
+        Append(request_uri_, at, length);
+        url_parsed_ = false;
         return 0;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnUrl(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnStatus(const char *at, size_t length)
     {
-        request_uri_.append(at, length);
+        Append(response_status_, at, length);
+        return 0;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnHeaderField(const char *at, size_t length)
+    {
+        if (kv_state_ != 1) {
+            if (kv_state_ == 2)
+                FinishField();
+            NewField();
+            kv_state_ = 1;
+        }
+
+        Append(header_fields_.back().first, at, length);
         return 0;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnStatus(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnHeaderValue(const char *at, size_t length)
     {
-        response_status_.append(at, length);
+        if (!kv_state_)
+            NewField();
+        kv_state_ = 2;
+        Append(header_fields_.back().second, at, length);
         return 0;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnHeaderField(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnField(const char *k, size_t k_len, const char *v, size_t v_len)
     {
-        if (kv_state_ == 1) {
-            header_fields_.emplace_back(std::move(callback_header_key_cache_),
-                    std::move(callback_header_value_cache_));
-            kv_state_ = 0;
+        if (!k) {
+            // 多行头部域的续行: 按RFC 7230 3.2.4把换行和行首空白替换成一个SP, 各引擎得到的域值相同
+            while (v_len && (*v == ' ' || *v == '\t')) {
+                ++v;
+                --v_len;
+            }
+            if (header_fields_.empty() || !v_len)
+                return 0;
+            string_t & value = header_fields_.back().second;
+            if (!value.empty())
+                Append(value, " ", 1);
+            Append(value, v, v_len);
+            return 0;
         }
 
-        callback_header_key_cache_.append(at, length);
+        auto & kv = NewField();
+        Assign(kv.first, k, k_len);
+        Assign(kv.second, v, v_len);
+        OnFieldAppended();
         return 0;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnHeaderValue(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnHeadersComplete()
     {
-        kv_state_ = 1;
-        callback_header_value_cache_.append(at, length);
+        if (kv_state_)
+            FinishField();
+        headers_done_ = true;
         return 0;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::OnBody(http_parser *parser, const char *at, size_t length)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnBody(const char *at, size_t length)
     {
-        body_.append(at, length);
+        if (body_sink_)
+            body_sink_(at, length);
+        if (store_body_)
+            Append(body_, at, length);
+        if (record_body_fragments_ && length) {
+            // 与上一个片段相邻时合并, 块之间有CRLF分隔, 不会跨块合并
+            if (!body_fragments_.empty() &&
+                    (const char*)body_fragments_.back().iov_base + body_fragments_.back().iov_len == at)
+            {
+                body_fragments_.back().iov_len += length;
+            } else {
+                body_fragments_.push_back(iovec{(void*)at, length});
+                if (!chunks_.empty())
+                    ++chunks_.back().fragment_count;
+            }
+        }
         return 0;
     }
-#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnChunkHeader(uint64_t size)
+    {
+        if (record_body_fragments_)
+            chunks_.push_back(ChunkInfo{size, body_fragments_.size(), 0});
+        return 0;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnChunkComplete()
+    {
+        return 0;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnMessageComplete()
+    {
+        // chunked消息的trailer域之后没有OnHeadersComplete
+        if (kv_state_)
+            FinishField();
+        parse_done_ = true;
+        return 0;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::OnParseError(std::error_code const& ec)
+    {
+        ec_ = ec;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::OnUpgrade()
+    {
+        upgrade_ = true;
+    }
 
-    template <typename StringT>
-    inline void THttpDocument<StringT>::Reset()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::ParseDone()
     {
-#if USE_PICO
-#else
-        http_parser_init(&parser_, IsRequest() ? HTTP_REQUEST : HTTP_RESPONSE);
-        parser_.data = this;
-#endif
+        return parse_done_;
+    }
 
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Reset()
+    {
+        backend_.Reset(this);
+
+        headers_done_ = false;
         parse_done_ = false;
+        upgrade_ = false;
         ec_ = std::error_code();
+        OnMessageBegin();
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::OnMessageBegin()
+    {
         kv_state_ = 0;
-        callback_header_key_cache_.clear();
-        callback_header_value_cache_.clear();
         major_ = 1;
         minor_ = 1;
-        request_method_.clear();
-        request_uri_.clear();
+        Clear(request_method_);
+        Clear(request_uri_);
+        url_parsed_ = false;
         response_status_code_ = 0;
-        response_status_.clear();
-        header_fields_.clear();
-        body_.clear();
+        Clear(response_status_);
+        RecycleFields();
+        ClearFieldIndex();
+        std::fill(std::begin(known_fields_), std::end(known_fields_), 0);
+        Clear(body_);
+        body_fragments_.clear();
+        chunks_.clear();
+        // 字段都已清除, 不会再引用arena_中的数据
+        arena_.Reset();
+        return 0;
     }
 
     // 返回解析错误码
-    template <typename StringT>
-    inline std::error_code THttpDocument<StringT>::ParseError()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline std::error_code THttpDocument<StringT, Backend, Alloc>::ParseError()
     {
         return ec_;
     }
 
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::IsInitialized() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::IsInitialized() const
     {
         if (IsRequest())
             return CheckMethod() && CheckUri() && CheckVersion();
@@ -236,8 +523,8 @@ namespace rapidhttp {
             return CheckVersion() && CheckStatusCode() && CheckStatus();
     }
 
-    template <typename StringT>
-    inline size_t THttpDocument<StringT>::ByteSize() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::ByteSize() const
     {
         if (!IsInitialized()) return 0;
 
@@ -252,21 +539,23 @@ namespace rapidhttp {
             bytes += response_status_.size() + 2;  // okCRLF
         }
         for (auto const& kv : header_fields_) {
-            bytes += kv.first.size() + 2 + kv.second.size() + 2;
+            if (!kv.first.empty())
+                bytes += kv.first.size() + 2 + kv.second.size() + 2;
         }
         bytes += 2;
         bytes += body_.size();
         return bytes;
     }
 
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::Serialize(char *buf, size_t len)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::Serialize(char *buf, size_t len)
     {
         size_t bytes = ByteSize();
         if (!bytes || len < bytes) return false;
 #define _WRITE_STRING(ss) \
         do {\
-            memcpy(buf, ss.c_str(), ss.size()); \
+            if (!ss.empty()) /* 空的std::string_view的data()是nullptr */ \
+                memcpy(buf, ss.data(), ss.size()); \
             buf += ss.size(); \
         } while(0);
 
@@ -303,6 +592,8 @@ namespace rapidhttp {
         }
         _WRITE_CRLF();
         for (auto const& kv : header_fields_) {
+            if (kv.first.empty())
+                continue;
             _WRITE_STRING(kv.first);
             *buf++ = ':';
             *buf++ = ' ';
@@ -318,8 +609,8 @@ namespace rapidhttp {
 #undef _WRITE_C_STR
 #undef _WRITE_STRING
     }
-    template <typename StringT>
-    inline std::string THttpDocument<StringT>::SerializeAsString()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline std::string THttpDocument<StringT, Backend, Alloc>::SerializeAsString()
     {
         std::string s;
         size_t bytes = ByteSize();
@@ -328,160 +619,558 @@ namespace rapidhttp {
         if (!Serialize(&s[0], bytes)) return "";
         return s;
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::CheckMethod() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::CheckMethod() const
     {
         return !request_method_.empty();
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::CheckUri() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::CheckUri() const
     {
         return !request_uri_.empty() && request_uri_[0] == '/';
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::CheckStatusCode() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::CheckStatusCode() const
     {
         return response_status_code_ >= 100 && response_status_code_ < 1000;
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::CheckStatus() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::CheckStatus() const
     {
         return !response_status_.empty();
     }
-    template <typename StringT>
-    inline bool THttpDocument<StringT>::CheckVersion() const
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::CheckVersion() const
     {
         return major_ >= 0 && major_ <= 9 && minor_ >= 0 && minor_ <= 9;
     }
     /// --------------------------------------------------------
 
     /// ------------------- fields get/set ---------------------
-    template <typename StringT>
-    inline StringT const& THttpDocument<StringT>::GetMethod()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline StringT const& THttpDocument<StringT, Backend, Alloc>::GetMethod()
     {
         return request_method_;
     }
     
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetMethod(const char* m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetMethod(const char* m)
     {
         request_method_ = m;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetMethod(std::string const& m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetMethod(std::string const& m)
     {
-        request_method_ = m;
+        AssignString(request_method_, m);
     }
-    template <typename StringT>
-    inline StringT const& THttpDocument<StringT>::GetUri()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline StringT const& THttpDocument<StringT, Backend, Alloc>::GetUri()
     {
         return request_uri_;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetUri(const char* m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetUri(const char* m)
     {
         request_uri_ = m;
+        url_parsed_ = false;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetUri(std::string const& m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetUri(std::string const& m)
     {
-        request_uri_ = m;
+        AssignString(request_uri_, m);
+        url_parsed_ = false;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline UrlView const& THttpDocument<StringT, Backend, Alloc>::GetUrl()
+    {
+        if (!url_parsed_) {
+            url_.Parse(request_uri_.data(), request_uri_.size(),
+                    IsRequest() && request_method_ == "CONNECT");
+            url_parsed_ = true;
+        }
+        return url_;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline bool THttpDocument<StringT, Backend, Alloc>::NormalizeUri()
+    {
+        static_assert(!IsRefString<StringT>::value,
+                "NormalizeUri() modifies the uri in place, use NormalizeUri(buf, len) instead");
+
+        UrlView const& url = GetUrl();
+        if (!url.valid)
+            return false;
+        if (url.path.empty())
+            return true;
+
+        size_t offset = url.path.c_str() - request_uri_.c_str();
+        size_t path_len = url.path.size();
+        if (!IsValidPercentEncoding(url.path.c_str(), path_len))
+            return false;
+
+        char* path = &request_uri_[offset];
+        long n = NormalizePath(path, path_len, path, path_len);
+        request_uri_.erase(offset + n, path_len - n);
+        url_parsed_ = false;
+        return true;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline long THttpDocument<StringT, Backend, Alloc>::NormalizeUri(char* buf, size_t len)
+    {
+        UrlView const& url = GetUrl();
+        if (!url.valid)
+            return -1;
+
+        const char* uri = request_uri_.data();
+        size_t uri_len = request_uri_.size();
+        size_t offset = url.path.empty() ? uri_len : url.path.c_str() - uri;
+        size_t path_len = url.path.size();
+        if (offset > len)
+            return -1;
+        memcpy(buf, uri, offset);
+
+        long n = NormalizePath(uri + offset, path_len, buf + offset, len - offset);
+        if (n < 0)
+            return -1;
+
+        size_t tail = uri_len - offset - path_len;
+        size_t bytes = offset + n + tail;
+        if (bytes > len)
+            return -1;
+        memcpy(buf + offset + n, uri + offset + path_len, tail);
+
+        request_uri_ = string_t(buf, bytes);
+        url_parsed_ = false;
+        return bytes;
     }
-    template <typename StringT>
-    inline StringT const& THttpDocument<StringT>::GetStatus()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline StringT const& THttpDocument<StringT, Backend, Alloc>::GetStatus()
     {
         return response_status_;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetStatus(const char* m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetStatus(const char* m)
     {
         response_status_ = m;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetStatus(std::string const& m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetStatus(std::string const& m)
     {
-        response_status_ = m;
+        AssignString(response_status_, m);
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::GetStatusCode()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::GetStatusCode()
     {
         return response_status_code_;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetStatusCode(int code)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetStatusCode(int code)
     {
         response_status_code_ = code;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::GetMajor()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::GetMajor()
     {
         return major_;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetMajor(int v)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetMajor(int v)
     {
         major_ = v;
     }
-    template <typename StringT>
-    inline int THttpDocument<StringT>::GetMinor()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline int THttpDocument<StringT, Backend, Alloc>::GetMinor()
     {
         return minor_;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetMinor(int v)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetMinor(int v)
     {
         minor_ = v;
     }
-    template <typename StringT>
-    inline StringT const& THttpDocument<StringT>::GetField(std::string const& k)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline StringT const& THttpDocument<StringT, Backend, Alloc>::GetField(std::string const& k)
     {
         static const string_t empty_string;
-        auto it = std::find_if(header_fields_.begin(), header_fields_.end(),
-                [&](std::pair<string_t, string_t> const& kv)
-                {
-                    return kv.first == k;
-                });
-        if (header_fields_.end() == it)
+        long index = FindField(k.c_str(), k.size());
+        if (index < 0)
             return empty_string;
         else
-            return it->second;
-    }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetField(std::string const& k, const char* m)
-    {
-        auto it = std::find_if(header_fields_.begin(), header_fields_.end(),
-                [&](std::pair<string_t, string_t> const& kv)
-                {
-                    return kv.first == k;
-                });
-        if (header_fields_.end() == it)
-            header_fields_.emplace_back(k, m);
-        else
-            it->second = m;
+            return header_fields_[index].second;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetField(std::string const& k, const char* m)
+    {
+        long index = FindField(k.c_str(), k.size());
+        if (index < 0) {
+            // 不能直接emplace_back(k, m), StringRef会引用m构造出来的临时std::string
+            auto & kv = NewField();
+            Assign(kv.first, k.c_str(), k.size());
+            kv.second = m;
+            OnFieldAppended();
+        } else
+            header_fields_[index].second = m;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetField(std::string const& k, std::string const& m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetField(std::string const& k, std::string const& m)
     {
         return SetField(k, m.c_str());
     }
-    template <typename StringT>
-    inline StringT const& THttpDocument<StringT>::GetBody()
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::AddField(std::string const& k, const char* m)
+    {
+        auto & kv = NewField();
+        Assign(kv.first, k.c_str(), k.size());
+        kv.second = m;
+        OnFieldAppended();
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::AddField(std::string const& k, std::string const& m)
+    {
+        return AddField(k, m.c_str());
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline typename THttpDocument<StringT, Backend, Alloc>::field_range_t
+    THttpDocument<StringT, Backend, Alloc>::GetFields(std::string const& k)
+    {
+        return field_range_t(header_fields_, k);
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::RemoveField(std::string const& k)
+    {
+        if (k.empty())
+            return 0;
+
+        size_t count = 0;
+        for (auto & kv : header_fields_) {
+            if (CaseInsensitiveEqual(kv.first.data(), kv.first.size(), k.c_str(), k.size())) {
+                Clear(kv.first);
+                Clear(kv.second);
+                ++count;
+            }
+        }
+
+        // 同名的域都删除了. 哈希索引中的位置不用清除, 名字为空不会再匹配
+        KnownHeader h = FindKnownHeader(k.c_str(), k.size());
+        if (h != KnownHeader::Count)
+            known_fields_[(size_t)h] = 0;
+        return count;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline StringT const& THttpDocument<StringT, Backend, Alloc>::GetField(KnownHeader h)
+    {
+        static const string_t empty_string;
+        size_t index = known_fields_[(size_t)h];
+        if (!index)
+            return empty_string;
+        else
+            return header_fields_[index - 1].second;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline StringT const& THttpDocument<StringT, Backend, Alloc>::GetBody()
     {
         return body_;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetBody(const char* m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetBody(const char* m)
     {
         body_ = m;
     }
-    template <typename StringT>
-    inline void THttpDocument<StringT>::SetBody(std::string const& m)
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::SetBody(std::string const& m)
     {
-        body_ = m;
+        AssignString(body_, m);
+    }
+
+    template <typename StringT, typename Backend, typename Alloc>
+    inline long THttpDocument<StringT, Backend, Alloc>::FindField(const char* k, size_t k_len)
+    {
+        // 删除的域名字为空, 空的k不能匹配到它们
+        if (!k_len)
+            return -1;
+
+        if (header_fields_.size() < c_field_index_min_fields) {
+            size_t count = header_fields_.size() - (kv_state_ ? 1 : 0);
+            for (size_t i = 0; i < count; ++i) {
+                string_t const& name = header_fields_[i].first;
+                if (CaseInsensitiveEqual(name.data(), name.size(), k, k_len))
+                    return i;
+            }
+            return -1;
+        }
+
+        UpdateFieldIndex();
+        uint32_t hash = CaseInsensitiveHash(k, k_len);
+        size_t mask = field_index_.size() - 1;
+        for (size_t pos = hash & mask; field_index_[pos].index; pos = (pos + 1) & mask) {
+            FieldSlot const& slot = field_index_[pos];
+            if (slot.hash != hash)
+                continue;
+            string_t const& name = header_fields_[slot.index - 1].first;
+            if (CaseInsensitiveEqual(name.data(), name.size(), k, k_len))
+                return slot.index - 1;
+        }
+        return -1;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::UpdateFieldIndex()
+    {
+        // 正在解析的域还不完整, 不能加入索引
+        size_t count = header_fields_.size() - (kv_state_ ? 1 : 0);
+        if (field_indexed_ == count)
+            return;
+
+        // 负载不超过1/2, 扩容时重建
+        if (count * 2 > field_index_.size()) {
+            size_t capacity = 16;
+            while (capacity < count * 2)
+                capacity <<= 1;
+            field_index_.assign(capacity, FieldSlot{0, 0});
+            field_indexed_ = 0;
+        }
+
+        // 按顺序插入, 线性探测时同名的域中下标小的排在前面
+        size_t mask = field_index_.size() - 1;
+        for (; field_indexed_ < count; ++field_indexed_) {
+            string_t const& name = header_fields_[field_indexed_].first;
+            if (name.empty())
+                continue;
+            uint32_t hash = CaseInsensitiveHash(name.data(), name.size());
+            size_t pos = hash & mask;
+            while (field_index_[pos].index)
+                pos = (pos + 1) & mask;
+            field_index_[pos].hash = hash;
+            field_index_[pos].index = field_indexed_ + 1;
+        }
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::OnFieldAppended()
+    {
+        string_t const& name = header_fields_.back().first;
+        KnownHeader h = FindKnownHeader(name.data(), name.size());
+        if (h != KnownHeader::Count && !known_fields_[(size_t)h] &&
+                header_fields_.size() <= std::numeric_limits<uint16_t>::max())
+            known_fields_[(size_t)h] = header_fields_.size();
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S>
+    inline void THttpDocument<StringT, Backend, Alloc>::Append(S & s, const char* at, size_t length)
+    {
+        s.append(at, length);
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Append(StringRef & s, const char* at, size_t length)
+    {
+        s.append(at, length, arena_);
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Append(std::string_view & s, const char* at, size_t length)
+    {
+        if (!length) return ;
+
+        // 与StringRef::append(first, length, arena)相同, 只是没有所有权
+        if (s.empty()) {
+            s = std::string_view(at, length);
+        } else if (s.data() + s.size() == at) {
+            s = std::string_view(s.data(), s.size() + length);
+        } else if (arena_.Extend(s.data(), s.size(), s.size() + length)) {
+            memcpy((char*)s.data() + s.size(), at, length);
+            s = std::string_view(s.data(), s.size() + length);
+        } else {
+            char* buf = arena_.Allocate(s.size() + length);
+            memcpy(buf, s.data(), s.size());
+            memcpy(buf + s.size(), at, length);
+            s = std::string_view(buf, s.size() + length);
+        }
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S>
+    inline void THttpDocument<StringT, Backend, Alloc>::Assign(S & s, const char* at, size_t length)
+    {
+        s.assign(at, length);
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Assign(StringRef & s, const char* at, size_t length)
+    {
+        s = StringRef(at, length);
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Assign(std::string_view & s, const char* at, size_t length)
+    {
+        s = std::string_view(at, length);
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S>
+    inline void THttpDocument<StringT, Backend, Alloc>::Clear(S & s)
+    {
+        s.clear();
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::Clear(std::string_view & s)
+    {
+        s = std::string_view();
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    inline std::pair<StringT, StringT> & THttpDocument<StringT, Backend, Alloc>::NewField()
+    {
+        if (spare_fields_.empty()) {
+            header_fields_.emplace_back();
+        } else {
+            // 回收的域保留着上一个消息的内容, 只复用容量
+            header_fields_.emplace_back(std::move(spare_fields_.back()));
+            spare_fields_.pop_back();
+            Clear(header_fields_.back().first);
+            Clear(header_fields_.back().second);
+        }
+        return header_fields_.back();
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::FinishField()
+    {
+        kv_state_ = 0;
+        OnFieldAppended();
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::RecycleFields()
+    {
+        // StringRef/std::string_view没有容量可以复用
+        if (!IsRefString<StringT>::value) {
+            for (auto & kv : header_fields_)
+                spare_fields_.push_back(std::move(kv));
+        }
+        header_fields_.clear();
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S, typename ArenaT>
+    inline void THttpDocument<StringT, Backend, Alloc>::AdoptString(S &, ArenaT const&)
+    {
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename ArenaT>
+    inline void THttpDocument<StringT, Backend, Alloc>::AdoptString(StringRef & s, ArenaT const& src_arena)
+    {
+        if (src_arena.Contains(s.c_str()))
+            s.CopyToArena(arena_);
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename ArenaT>
+    inline void THttpDocument<StringT, Backend, Alloc>::AdoptString(std::string_view & s, ArenaT const& src_arena)
+    {
+        if (!s.empty() && src_arena.Contains(s.data())) {
+            char* buf = arena_.Allocate(s.size());
+            memcpy(buf, s.data(), s.size());
+            s = std::string_view(buf, s.size());
+        }
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::FrozenSize(S const&) const
+    {
+        return 0;
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::FrozenSize(StringRef const& s) const
+    {
+        // 已经在arena_中的不用再拷贝
+        if (s.empty() || arena_.Contains(s.c_str()))
+            return 0;
+        return s.size();
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    inline size_t THttpDocument<StringT, Backend, Alloc>::FrozenSize(std::string_view const& s) const
+    {
+        if (s.empty() || arena_.Contains(s.data()))
+            return 0;
+        return s.size();
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S>
+    inline void THttpDocument<StringT, Backend, Alloc>::FreezeString(S &, char* &)
+    {
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::FreezeString(StringRef & s, char* & pos)
+    {
+        size_t len = FrozenSize(s);
+        if (!len)
+            return ;
+        memcpy(pos, s.c_str(), len);
+        s = StringRef(pos, len);
+        pos += len;
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::FreezeString(std::string_view & s, char* & pos)
+    {
+        size_t len = FrozenSize(s);
+        if (!len)
+            return ;
+        memcpy(pos, s.data(), len);
+        s = std::string_view(pos, len);
+        pos += len;
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    template <typename S>
+    inline void THttpDocument<StringT, Backend, Alloc>::RebaseString(S &, const char*, size_t, const char*)
+    {
+    }
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::RebaseString(StringRef & s,
+            const char* old_base, size_t len, const char* new_base)
+    {
+        s.Rebase(old_base, len, new_base);
+    }
+#if RAPIDHTTP_HAS_STRING_VIEW
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::RebaseString(std::string_view & s,
+            const char* old_base, size_t len, const char* new_base)
+    {
+        if (!s.empty() && s.data() >= old_base && s.data() + s.size() <= old_base + len)
+            s = std::string_view(new_base + (s.data() - old_base), s.size());
+    }
+#endif
+    template <typename StringT, typename Backend, typename Alloc>
+    inline void THttpDocument<StringT, Backend, Alloc>::ClearFieldIndex()
+    {
+        if (field_indexed_) {
+            std::fill(field_index_.begin(), field_index_.end(), FieldSlot{0, 0});
+            field_indexed_ = 0;
+        }
     }
     /// --------------------------------------------------------
 
+    // 字段和容器都使用Alloc分配内存的document
+    template <typename Alloc, typename Backend = HttpParserBackend>
+    using TAllocHttpDocument = THttpDocument<
+        std::basic_string<char, std::char_traits<char>, Alloc>, Backend, Alloc>;
+    template <typename Alloc, typename Backend = HttpParserBackend>
+    using TAllocHttpDocumentRef = THttpDocument<StringRef, Backend, Alloc>;
+
     typedef THttpDocument<std::string> HttpDocument;
     typedef THttpDocument<StringRef> HttpDocumentRef;
 
+    typedef THttpDocument<std::string, NativeBackend> NativeHttpDocument;
+    typedef THttpDocument<StringRef, NativeBackend> NativeHttpDocumentRef;
+
+#if RAPIDHTTP_HAS_STRING_VIEW
+    // 字段是std::string_view, 与HttpDocumentRef一样引用输入缓冲区, 不连续的字段拷贝到arena中
+    typedef THttpDocument<std::string_view> HttpDocumentView;
+    typedef THttpDocument<std::string_view, NativeBackend> NativeHttpDocumentView;
+#endif
+
+#if USE_PICO
+    typedef THttpDocument<std::string, PicoBackend> PicoHttpDocument;
+    typedef THttpDocument<StringRef, PicoBackend> PicoHttpDocumentRef;
+#endif
+
 } //namespace rapidhttp 
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <rapidhttp/document.h>
+
+namespace rapidhttp {
+
+// document对象池.
+// 回收的document保留了头部域, 字符串, arena等的容量, 复用时解析同样大小的消息不再分配内存,
+// 也省去了构造document和初始化解析引擎的开销.
+// 不是线程安全的, 每个线程使用自己的池(ThreadLocal()), document也要归还给取出它的池.
+template <typename DocType>
+class TDocumentPool
+{
+public:
+    // 析构时把document归还给池
+    struct Deleter
+    {
+        TDocumentPool* pool;
+
+        void operator()(DocType* doc) const
+        {
+            pool->Release(doc);
+        }
+    };
+    typedef std::unique_ptr<DocType, Deleter> pointer;
+
+    // @max_idle: 每种类型(Request/Response)最多保留的空闲document数量, 超过时直接释放
+    explicit TDocumentPool(size_t max_idle = c_document_pool_max_idle)
+        : max_idle_(max_idle)
+    {}
+
+    TDocumentPool(TDocumentPool const& other) = delete;
+    TDocumentPool& operator=(TDocumentPool const& other) = delete;
+
+    ~TDocumentPool()
+    {
+        for (auto & idle : idle_)
+            for (DocType* doc : idle)
+                delete doc;
+    }
+
+    /// 取出一个已重置的document, 池为空时新建一个
+    inline pointer Acquire(DocumentType type)
+    {
+        std::vector<DocType*> & idle = idle_[type];
+        DocType* doc;
+        if (idle.empty()) {
+            doc = new DocType(type);
+        } else {
+            doc = idle.back();
+            idle.pop_back();
+        }
+        return pointer(doc, Deleter{this});
+    }
+
+    /// 归还document
+    // 重置解析状态, 恢复默认的设置(body接收器, 暂停等), 保留内部的容量
+    inline void Release(DocType* doc)
+    {
+        if (!doc)
+            return ;
+
+        std::vector<DocType*> & idle = idle_[doc->IsRequest() ? Request : Response];
+        if (idle.size() >= max_idle_) {
+            delete doc;
+            return ;
+        }
+
+        doc->SetBodySink(typename DocType::BodySink(), true);
+        doc->SetRecordBodyFragments(false);
+        doc->SetPauseAtHeaders(false);
+        doc->Reset();
+        idle.push_back(doc);
+    }
+
+    // 空闲的document数量
+    inline size_t IdleCount(DocumentType type) const
+    {
+        return idle_[type].size();
+    }
+
+    /// 当前线程的池
+    static TDocumentPool& ThreadLocal()
+    {
+        static thread_local TDocumentPool pool;
+        return pool;
+    }
+
+private:
+    size_t max_idle_;
+    std::vector<DocType*> idle_[2];     // 按DocumentType分开
+};
+
+} //namespace rapidhttp
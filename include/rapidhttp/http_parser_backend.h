@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string.h>
+#include <rapidhttp/layer.hpp>
+#include <rapidhttp/error_code.h>
+
+namespace rapidhttp {
+
+// 基于http-parser的解析引擎(默认引擎).
+// 流式状态机, 解析到的每段token都通过回调写入document, 天然支持任意位置的断包.
+class HttpParserBackend
+{
+public:
+    // 回调表是每种document类型共享的静态常量(见Settings), 构造时不需要初始化
+    template <typename DocT>
+    inline void Init(DocT * doc)
+    {
+    }
+
+    template <typename DocT>
+    inline void Reset(DocT * doc)
+    {
+        http_parser_init(&parser_, doc->IsRequest() ? HTTP_REQUEST : HTTP_RESPONSE);
+        parser_.data = doc;
+    }
+
+    template <typename DocT>
+    inline size_t PartailParse(DocT * doc, const char* buf_ref, size_t len)
+    {
+        size_t parsed = Execute(doc, buf_ref, len);
+        if (parser_.state == s_headers_done) {
+            // 在on_headers_complete中暂停时停在头部结尾的LF上,
+            // 吃掉这个字节, 使返回值恰好是body第一个字节的偏移.
+            parsed += Execute(doc, buf_ref + parsed, 1);
+        }
+        return parsed;
+    }
+
+    template <typename DocT>
+    inline bool PartailParseEof(DocT * doc)
+    {
+        PartailParse(doc, "", 0);
+        return doc->ParseDone();
+    }
+
+    template <typename DocT>
+    inline void CopyTo(HttpParserBackend & clone, DocT * clone_doc) const
+    {
+        clone.Init(clone_doc);
+        clone.parser_ = parser_;
+        clone.parser_.data = clone_doc;
+    }
+
+    // document移动时调用, 解析状态转移给dst, 回调改为写入dst_doc
+    template <typename DocT>
+    inline void MoveTo(HttpParserBackend & dst, DocT * dst_doc)
+    {
+        dst.parser_ = parser_;
+        dst.parser_.data = dst_doc;
+    }
+
+private:
+    template <typename DocT>
+    inline size_t Execute(DocT * doc, const char* buf_ref, size_t len)
+    {
+        size_t parsed = http_parser_execute(&parser_, &Settings<DocT>::value, buf_ref, len);
+        if (parser_.http_errno == HPE_PAUSED) {
+            // 在消息结尾或头部结尾处暂停的(见sOnMessageComplete, sOnHeadersComplete), 不是错误
+            http_parser_pause(&parser_, 0);
+        } else if (parser_.http_errno) {
+            doc->OnParseError(MakeParseErrorCode(parser_.http_errno));
+        }
+        return parsed;
+    }
+
+    template <typename DocT>
+    static inline int sOnHeadersComplete(http_parser *parser)
+    {
+        DocT* doc = (DocT*)parser->data;
+        if (doc->IsRequest())
+            doc->SetMethod(http_method_str((http_method)parser->method));
+        else
+            doc->SetStatusCode(parser->status_code);
+        doc->SetMajor(parser->http_major);
+        doc->SetMinor(parser->http_minor);
+        if (parser->upgrade)
+            doc->OnUpgrade();
+        if (doc->pause_at_headers_)
+            http_parser_pause(parser, 1);
+        return doc->OnHeadersComplete();
+    }
+    template <typename DocT>
+    static inline int sOnMessageComplete(http_parser *parser)
+    {
+        // http-parser在同一次execute中会直接开始解析下一个消息(pipeline),
+        // 这里暂停下来, 让PartailParse恰好停在消息结尾处.
+        http_parser_pause(parser, 1);
+        return ((DocT*)parser->data)->OnMessageComplete();
+    }
+    template <typename DocT>
+    static inline int sOnUrl(http_parser *parser, const char *at, size_t length)
+    {
+        return ((DocT*)parser->data)->OnUrl(at, length);
+    }
+    template <typename DocT>
+    static inline int sOnStatus(http_parser *parser, const char *at, size_t length)
+    {
+        return ((DocT*)parser->data)->OnStatus(at, length);
+    }
+    template <typename DocT>
+    static inline int sOnHeaderField(http_parser *parser, const char *at, size_t length)
+    {
+        return ((DocT*)parser->data)->OnHeaderField(at, length);
+    }
+    template <typename DocT>
+    static inline int sOnHeaderValue(http_parser *parser, const char *at, size_t length)
+    {
+        return ((DocT*)parser->data)->OnHeaderValue(at, length);
+    }
+    template <typename DocT>
+    static inline int sOnBody(http_parser *parser, const char *at, size_t length)
+    {
+        return ((DocT*)parser->data)->OnBody(at, length);
+    }
+    template <typename DocT>
+    static inline int sOnChunkHeader(http_parser *parser)
+    {
+        // 回调时content_length是当前块的长度
+        return ((DocT*)parser->data)->OnChunkHeader(parser->content_length);
+    }
+    template <typename DocT>
+    static inline int sOnChunkComplete(http_parser *parser)
+    {
+        return ((DocT*)parser->data)->OnChunkComplete();
+    }
+
+private:
+    // 每种document类型一份回调表, 常量初始化, 没有运行时开销
+    template <typename DocT>
+    struct Settings
+    {
+        static const struct http_parser_settings value;
+    };
+
+    struct http_parser parser_;
+};
+
+template <typename DocT>
+const struct http_parser_settings HttpParserBackend::Settings<DocT>::value = {
+    nullptr,                                            // on_message_begin
+    HttpParserBackend::sOnUrl<DocT>,                    // on_url
+    HttpParserBackend::sOnStatus<DocT>,                 // on_status
+    HttpParserBackend::sOnHeaderField<DocT>,            // on_header_field
+    HttpParserBackend::sOnHeaderValue<DocT>,            // on_header_value
+    HttpParserBackend::sOnHeadersComplete<DocT>,        // on_headers_complete
+    HttpParserBackend::sOnBody<DocT>,                   // on_body
+    HttpParserBackend::sOnMessageComplete<DocT>,        // on_message_complete
+    HttpParserBackend::sOnChunkHeader<DocT>,            // on_chunk_header
+    HttpParserBackend::sOnChunkComplete<DocT>,          // on_chunk_complete
+};
+
+} //namespace rapidhttp
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <rapidhttp/util.h>
+
+namespace rapidhttp {
+
+// 常用的头部域, 解析时记录位置, 用GetField(KnownHeader::Host)按下标直接取值
+enum class KnownHeader : uint8_t
+{
+    Host,
+    Connection,
+    ContentLength,
+    ContentType,
+    TransferEncoding,
+    Upgrade,
+    Cookie,
+    SetCookie,
+    UserAgent,
+    Accept,
+    AcceptEncoding,
+    Authorization,
+    Expect,
+    Location,
+
+    Count,  // 数量, 不是头部域
+};
+
+static const size_t c_known_header_count = (size_t)KnownHeader::Count;
+
+// 与KnownHeader的顺序一致
+inline const char* KnownHeaderName(KnownHeader h)
+{
+    static const char* names[c_known_header_count] = {
+        "Host",
+        "Connection",
+        "Content-Length",
+        "Content-Type",
+        "Transfer-Encoding",
+        "Upgrade",
+        "Cookie",
+        "Set-Cookie",
+        "User-Agent",
+        "Accept",
+        "Accept-Encoding",
+        "Authorization",
+        "Expect",
+        "Location",
+    };
+    return names[(size_t)h];
+}
+
+// k与小写的name比较(忽略大小写), 长度已经相等
+inline bool KnownHeaderEqual(const char* k, const char* name, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        if (ToLower(k[i]) != name[i])
+            return false;
+    return true;
+}
+
+/// 识别常用的头部域(忽略大小写)
+// 先按长度和首字母过滤, 大部分不认识的域名只需要几次比较.
+// @returns: 不是常用的头部域时返回KnownHeader::Count
+inline KnownHeader FindKnownHeader(const char* k, size_t len)
+{
+#define _KNOWN(c, h, name) \
+    case c: \
+        if (KnownHeaderEqual(k + 1, name + 1, len - 1)) \
+            return KnownHeader::h; \
+        break
+
+    if (!len)
+        return KnownHeader::Count;
+
+    char c = ToLower(k[0]);
+    switch (len) {
+        case 4:
+            switch (c) { _KNOWN('h', Host, "host"); }
+            break;
+        case 6:
+            switch (c) {
+                _KNOWN('c', Cookie, "cookie");
+                _KNOWN('a', Accept, "accept");
+                _KNOWN('e', Expect, "expect");
+            }
+            break;
+        case 7:
+            switch (c) { _KNOWN('u', Upgrade, "upgrade"); }
+            break;
+        case 8:
+            switch (c) { _KNOWN('l', Location, "location"); }
+            break;
+        case 10:
+            switch (c) {
+                _KNOWN('c', Connection, "connection");
+                _KNOWN('s', SetCookie, "set-cookie");
+                _KNOWN('u', UserAgent, "user-agent");
+            }
+            break;
+        case 12:
+            switch (c) { _KNOWN('c', ContentType, "content-type"); }
+            break;
+        case 13:
+            switch (c) { _KNOWN('a', Authorization, "authorization"); }
+            break;
+        case 14:
+            switch (c) { _KNOWN('c', ContentLength, "content-length"); }
+            break;
+        case 15:
+            switch (c) { _KNOWN('a', AcceptEncoding, "accept-encoding"); }
+            break;
+        case 17:
+            switch (c) { _KNOWN('t', TransferEncoding, "transfer-encoding"); }
+            break;
+    }
+    return KnownHeader::Count;
+#undef _KNOWN
+}
+
+} //namespace rapidhttp
@@ -391,6 +391,7 @@ inline int http_body_is_final(const http_parser *parser);
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <rapidhttp/simd.h>
 namespace rapidhttp {
 
 #ifndef ULLONG_MAX
@@ -1671,6 +1672,8 @@ reexecute:
 
           switch (parser->header_state) {
             case h_general:
+              /* Skip the rest of the token, the next round stops at ':' */
+              p = simd::FindTokenEnd(p + 1, data + len, !HTTP_PARSER_STRICT) - 1;
               break;
 
             case h_C:
@@ -1898,24 +1901,13 @@ reexecute:
           switch (h_state) {
             case h_general:
             {
-              const char* p_cr;
-              const char* p_lf;
               size_t limit = data + len - p;
 
               limit = MIN(limit, HTTP_MAX_HEADER_SIZE);
 
-              p_cr = (const char*) memchr(p, CR, limit);
-              p_lf = (const char*) memchr(p, LF, limit);
-              if (p_cr != NULL) {
-                if (p_lf != NULL && p_cr >= p_lf)
-                  p = p_lf;
-                else
-                  p = p_cr;
-              } else if (UNLIKELY(p_lf != NULL)) {
-                p = p_lf;
-              } else {
-                p = data + len;
-              }
+              /* Stop at CR, LF or the first invalid char, the next round
+               * handles (or rejects) it. */
+              p = simd::FindHeaderValueEnd(p + 1, p + limit);
               --p;
 
               break;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <rapidhttp/util.h>
+
+namespace rapidhttp {
+
+// 决定消息边界的头部域(Transfer-Encoding/Content-Length/Upgrade/Connection), NativeBackend和PicoBackend共用.
+// 判定规则与http-parser一致: 不同的引擎对同一个消息的结尾理解不同会导致请求走私.
+struct MessageFraming
+{
+    bool chunked = false;
+    bool has_content_length = false;
+    bool upgrade = false;               // 有Upgrade头部域
+    bool connection_upgrade = false;    // Connection中有upgrade
+    bool last_is_framing = false;       // 上一个域是Transfer-Encoding或Content-Length
+    uint64_t content_length = 0;
+
+    inline void Reset()
+    {
+        *this = MessageFraming();
+    }
+
+    // k为空表示多行头部域的续行
+    // @returns: 头部域格式错误时返回false
+    inline bool OnField(const char* k, size_t k_len, const char* v, size_t v_len)
+    {
+        // 续行不会再参与判定, 折叠的Transfer-Encoding/Content-Length直接拒绝
+        if (!k)
+            return !last_is_framing;
+
+        last_is_framing = false;
+        if (k_len == 17 && CaseInsensitiveEqual(k, k_len, "Transfer-Encoding", 17)) {
+            chunked = IsChunkedCoding(v, v_len);
+            last_is_framing = true;
+        } else if (k_len == 14 && CaseInsensitiveEqual(k, k_len, "Content-Length", 14)) {
+            last_is_framing = true;
+            if (!v_len || has_content_length)
+                return false;
+
+            content_length = 0;
+            for (size_t i = 0; i < v_len; ++i) {
+                if (v[i] < '0' || v[i] > '9' || content_length > (UINT64_MAX - 9) / 10)
+                    return false;
+                content_length = content_length * 10 + (v[i] - '0');
+            }
+            has_content_length = true;
+        } else if (k_len == 7 && CaseInsensitiveEqual(k, k_len, "Upgrade", 7)) {
+            upgrade = true;
+        } else if (k_len == 10 && CaseInsensitiveEqual(k, k_len, "Connection", 10)) {
+            connection_upgrade = connection_upgrade || ContainsToken(v, v_len, "upgrade", 7);
+        }
+        return true;
+    }
+
+    // 头部块结束时检查: 与http-parser一样, 不能同时有chunked和Content-Length
+    inline bool Valid() const
+    {
+        return !(chunked && has_content_length);
+    }
+};
+
+} //namespace rapidhttp
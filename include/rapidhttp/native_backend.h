@@ -0,0 +1,521 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <rapidhttp/constants.h>
+#include <rapidhttp/error_code.h>
+#include <rapidhttp/util.h>
+#include <rapidhttp/simd.h>
+#include <rapidhttp/chunked_decoder.h>
+#include <rapidhttp/message_framing.h>
+
+namespace rapidhttp {
+
+// rapidhttp自己的解析引擎.
+// 一次扫描整个头部块, 每解析完一个域就直接写入document的头部表,
+// 没有逐token的回调和key/value缓存; body(包括chunked)直接引用输入缓冲区.
+// 头部不完整时回滚已写入的字段并缓存数据, 收到头部结束符后再从缓存中完整解析一次.
+class NativeBackend
+{
+public:
+    template <typename DocT>
+    inline void Init(DocT * doc)
+    {
+    }
+
+    template <typename DocT>
+    inline void Reset(DocT * doc)
+    {
+        state_ = ns_header;
+        ResetHeaderState();
+        header_cache_.clear();
+    }
+
+    template <typename DocT>
+    inline size_t PartailParse(DocT * doc, const char* buf_ref, size_t len)
+    {
+        size_t parsed = 0;
+        if (state_ == ns_header) {
+            parsed = ParseHeader(doc, buf_ref, len);
+            if (doc->ParseError() || state_ == ns_header || doc->pause_at_headers_)
+                return parsed;
+        }
+
+        if (!doc->ParseDone())
+            parsed += ParseBody(doc, buf_ref + parsed, len - parsed);
+        return parsed;
+    }
+
+    template <typename DocT>
+    inline bool PartailParseEof(DocT * doc)
+    {
+        if (state_ == ns_until_eof) {
+            state_ = ns_done;
+            doc->OnMessageComplete();
+        } else if (state_ != ns_header || !header_cache_.empty()) {
+            doc->OnParseError(MakeErrorCode(eErrorCode::parse_error));
+        }
+        return doc->ParseDone();
+    }
+
+    template <typename DocT>
+    inline void CopyTo(NativeBackend & clone, DocT * clone_doc) const
+    {
+        // 从缓存中解析的字段引用的是this->header_cache_和trailer缓存, 改为引用clone的缓存
+        clone = *this;
+        if (!header_cache_.empty())
+            clone_doc->Rebase(header_cache_.data(), header_cache_.size(), clone.header_cache_.data());
+        clone.chunked_decoder_.RebaseCache(clone_doc, chunked_decoder_.CacheData());
+    }
+
+    template <typename DocT>
+    inline void MoveTo(NativeBackend & dst, DocT * dst_doc)
+    {
+        // 短的缓存在std::string内部(SSO), 移动后地址会改变
+        const char* old_base = header_cache_.data();
+        size_t cache_len = header_cache_.size();
+        const char* old_trailer = chunked_decoder_.CacheData();
+        dst = std::move(*this);
+        if (cache_len)
+            dst_doc->Rebase(old_base, cache_len, dst.header_cache_.data());
+        dst.chunked_decoder_.RebaseCache(dst_doc, old_trailer);
+    }
+
+private:
+    enum eNativeState
+    {
+        ns_header,              // 解析头部
+        ns_content_length,      // 按Content-Length读取body
+        ns_chunked,             // 按chunked读取body
+        ns_until_eof,           // 读取body直到链接断开
+        ns_done,
+    };
+
+    enum eCharType
+    {
+        ct_token = 1,   // 头部域名/method允许的字符
+        ct_value = 2,   // 头部域值/status允许的字符(不包括CR/LF)
+    };
+
+    static inline const uint8_t* CharTable()
+    {
+        static const uint8_t table[256] = {
+        //  0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0,  // 0x00
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x10
+            2, 3, 2, 3, 3, 3, 3, 3, 2, 2, 3, 3, 2, 3, 3, 2,  // 0x20  !"#$%&'()*+,-./
+            3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2,  // 0x30 0-9:;<=>?
+            2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  // 0x40 @A-O
+            3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 3, 3,  // 0x50 P-Z[\]^_
+            3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  // 0x60 `a-o
+            3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 3, 2, 3, 0,  // 0x70 p-z{|}~DEL
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // 0x80 obs-text
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+            2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        };
+        return table;
+    }
+
+    static inline bool IsToken(char c)
+    {
+        return CharTable()[(uint8_t)c] & ct_token;
+    }
+
+    static inline bool IsValue(char c)
+    {
+        return CharTable()[(uint8_t)c] & ct_value;
+    }
+
+    // 跳过不小于bound且不是DEL的字节, 每次检查8个字节, 遇到其它字节时交给逐字节的检查
+    static inline const char* SkipPrintable(const char* pos, const char* last, uint8_t bound)
+    {
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t highs = 0x8080808080808080ULL;
+        for (; last - pos >= 8; pos += 8) {
+            uint64_t x;
+            memcpy(&x, pos, 8);
+            uint64_t del = x ^ (ones * 0x7f);
+            if (((x - ones * bound) & ~x & highs) | ((del - ones) & ~del & highs))
+                break;
+        }
+        return pos;
+    }
+
+    inline void ResetHeaderState()
+    {
+        http09_ = false;
+        first_line_done_ = false;
+        content_length_ = 0;
+        framing_.Reset();
+    }
+
+    template <typename DocT>
+    inline size_t ParseHeader(DocT * doc, const char* buf_ref, size_t len)
+    {
+        if (header_cache_.empty()) {
+            long ret = ParseHeaderBlock(doc, buf_ref, len);
+            if (ret >= 0)
+                return OnHeaderBlockDone(doc, ret);
+
+            if (ret == -1)
+                return OnError(doc);
+
+            // 数据不完整, 回滚已写入document的字段, 缓存起来等待后续数据.
+            doc->OnMessageBegin();
+            ResetHeaderState();
+            if (len > c_max_header_cache_size)
+                return OnError(doc);
+            header_cache_.assign(buf_ref, len);
+            first_line_done_ = memchr(buf_ref, '\n', len) != nullptr;
+            return len;
+        }
+
+        size_t last_len = header_cache_.size();
+        header_cache_.append(buf_ref, len);
+
+        // 只有收到头部结束符(或者首行刚刚完整, 可能是HTTP/0.9)时才重新解析.
+        bool first_line_done = first_line_done_ || memchr(buf_ref, '\n', len);
+        if (!FindHeaderEnd(last_len) && first_line_done == first_line_done_) {
+            if (header_cache_.size() > c_max_header_cache_size)
+                return OnError(doc);
+            return len;
+        }
+
+        long ret = ParseHeaderBlock(doc, header_cache_.data(), header_cache_.size());
+        if (ret >= 0 && (size_t)ret >= last_len)
+            return OnHeaderBlockDone(doc, ret) - last_len;
+
+        if (ret == -2) {
+            doc->OnMessageBegin();
+            ResetHeaderState();
+            first_line_done_ = first_line_done;
+            if (header_cache_.size() > c_max_header_cache_size)
+                return OnError(doc);
+            return len;
+        }
+
+        return OnError(doc);
+    }
+
+    // 从缓存的last_len附近开始查找空行
+    inline bool FindHeaderEnd(size_t last_len) const
+    {
+        const char* first = header_cache_.data();
+        const char* last = first + header_cache_.size();
+        const char* pos = first + (last_len > 3 ? last_len - 3 : 0);
+        while ((pos = (const char*)memchr(pos, '\n', last - pos)) != nullptr) {
+            ++pos;
+            if (pos < last && *pos == '\n')
+                return true;
+            if (pos + 1 < last && pos[0] == '\r' && pos[1] == '\n')
+                return true;
+        }
+        return false;
+    }
+
+    template <typename DocT>
+    inline size_t OnError(DocT * doc)
+    {
+        doc->OnParseError(MakeErrorCode(eErrorCode::parse_error));
+        return 0;
+    }
+
+    template <typename DocT>
+    inline size_t OnHeaderBlockDone(DocT * doc, size_t header_len)
+    {
+        // 与http-parser一致: CONNECT或者没有body的Upgrade消息在头部结尾处结束,
+        // 之后的数据属于其他协议
+        bool connect = doc->IsRequest() && doc->GetMethod() == "CONNECT";
+        bool upgrade = (framing_.upgrade && framing_.connection_upgrade) || connect;
+        if (upgrade)
+            doc->OnUpgrade();
+        doc->OnHeadersComplete();
+
+        int status = doc->IsRequest() ? 0 : doc->GetStatusCode();
+        if (http09_) {
+            state_ = ns_done;
+        } else if (upgrade && (connect || (!framing_.chunked && !framing_.content_length))) {
+            state_ = ns_done;
+        } else if (framing_.chunked) {
+            state_ = ns_chunked;
+            chunked_decoder_.Reset();
+        } else if (framing_.has_content_length) {
+            content_length_ = framing_.content_length;
+            state_ = content_length_ ? ns_content_length : ns_done;
+        } else if (doc->IsRequest() || status / 100 == 1 || status == 204 || status == 304) {
+            state_ = ns_done;
+        } else {
+            state_ = ns_until_eof;
+        }
+
+        if (state_ == ns_done)
+            doc->OnMessageComplete();
+        return header_len;
+    }
+
+    // 头部块不完整时返回-2, 格式错误返回-1, 成功返回头部块长度
+    template <typename DocT>
+    inline long ParseHeaderBlock(DocT * doc, const char* buf, size_t len)
+    {
+        const char* pos = buf;
+        const char* last = buf + len;
+        int ret = -2;
+
+        // 忽略请求行之前的空行
+        while (pos < last && (*pos == '\r' || *pos == '\n'))
+            ++pos;
+        if (doc->IsRequest())
+            pos = ParseRequestLine(doc, pos, last, ret);
+        else
+            pos = ParseStatusLine(doc, pos, last, ret);
+        if (!pos) return ret;
+        if (http09_) return pos - buf;
+
+        pos = ParseFields(doc, pos, last, ret);
+        if (!pos) return ret;
+
+        // 与http-parser一致: 同时有chunked和Content-Length时拒绝, 否则前端和这里对消息结尾的理解可能不同
+        if (!framing_.Valid())
+            return -1;
+        return pos - buf;
+    }
+
+    // 跳过行尾的CRLF或LF
+    static inline const char* EatEol(const char* pos, const char* last, int & ret)
+    {
+        if (pos == last) {
+            ret = -2;
+            return nullptr;
+        }
+
+        if (*pos == '\r') {
+            if (++pos == last) {
+                ret = -2;
+                return nullptr;
+            }
+        }
+
+        if (*pos != '\n') {
+            ret = -1;
+            return nullptr;
+        }
+        return pos + 1;
+    }
+
+    template <typename DocT>
+    inline const char* ParseVersion(DocT * doc, const char* pos, const char* last, int & ret)
+    {
+        if (last - pos < 8) {
+            ret = -2;
+            return nullptr;
+        }
+
+        if (memcmp(pos, "HTTP/", 5) != 0 || pos[5] < '0' || pos[5] > '9' ||
+                pos[6] != '.' || pos[7] < '0' || pos[7] > '9') {
+            ret = -1;
+            return nullptr;
+        }
+
+        doc->SetMajor(pos[5] - '0');
+        doc->SetMinor(pos[7] - '0');
+        return pos + 8;
+    }
+
+    template <typename DocT>
+    inline const char* ParseRequestLine(DocT * doc, const char* pos, const char* last, int & ret)
+    {
+        const char* method = pos;
+        while (pos < last && IsToken(*pos))
+            ++pos;
+        if (pos == last) {
+            ret = -2;
+            return nullptr;
+        }
+        if (*pos != ' ' || pos == method) {
+            ret = -1;
+            return nullptr;
+        }
+        doc->OnMethod(method, pos - method);
+
+        const char* uri = ++pos;
+        pos = SkipPrintable(pos, last, 0x21);
+        while (pos < last && (uint8_t)*pos > ' ' && *pos != 0x7f)
+            ++pos;
+        if (pos == last) {
+            ret = -2;
+            return nullptr;
+        }
+        if (pos == uri) {
+            ret = -1;
+            return nullptr;
+        }
+        doc->OnUrl(uri, pos - uri);
+
+        if (*pos == ' ') {
+            pos = ParseVersion(doc, pos + 1, last, ret);
+            if (!pos) return nullptr;
+            return EatEol(pos, last, ret);
+        }
+
+        // 没有版本号的请求行, 兼容HTTP/0.9
+        pos = EatEol(pos, last, ret);
+        if (!pos) return nullptr;
+        doc->SetMajor(0);
+        doc->SetMinor(9);
+        http09_ = true;
+        return pos;
+    }
+
+    template <typename DocT>
+    inline const char* ParseStatusLine(DocT * doc, const char* pos, const char* last, int & ret)
+    {
+        pos = ParseVersion(doc, pos, last, ret);
+        if (!pos) return nullptr;
+
+        if (last - pos < 5) {
+            ret = -2;
+            return nullptr;
+        }
+        if (pos[0] != ' ' || pos[1] < '0' || pos[1] > '9' ||
+                pos[2] < '0' || pos[2] > '9' || pos[3] < '0' || pos[3] > '9') {
+            ret = -1;
+            return nullptr;
+        }
+        doc->SetStatusCode((pos[1] - '0') * 100 + (pos[2] - '0') * 10 + (pos[3] - '0'));
+        pos += 4;
+
+        if (*pos == ' ') {
+            const char* status = ++pos;
+            pos = SkipPrintable(pos, last, 0x20);
+            while (pos < last && IsValue(*pos))
+                ++pos;
+            doc->OnStatus(status, pos - status);
+        } else if (*pos != '\r' && *pos != '\n') {
+            ret = -1;
+            return nullptr;
+        }
+
+        return EatEol(pos, last, ret);
+    }
+
+    template <typename DocT>
+    inline const char* ParseFields(DocT * doc, const char* pos, const char* last, int & ret)
+    {
+        bool has_field = false;
+        for (;;) {
+            if (pos == last) {
+                ret = -2;
+                return nullptr;
+            }
+
+            if (*pos == '\r' || *pos == '\n')
+                return EatEol(pos, last, ret);
+
+            const char* name = pos;
+            if (*pos == ' ' || *pos == '\t') {
+                // 多行的头部域, 续接到上一个域
+                if (!has_field) {
+                    ret = -1;
+                    return nullptr;
+                }
+                name = nullptr;
+            } else {
+                while (pos < last && IsToken(*pos))
+                    ++pos;
+                if (pos == last) {
+                    ret = -2;
+                    return nullptr;
+                }
+                if (*pos != ':' || pos == name) {
+                    ret = -1;
+                    return nullptr;
+                }
+                ++pos;
+            }
+            const char* name_last = name ? pos - 1 : nullptr;
+
+            while (pos < last && (*pos == ' ' || *pos == '\t'))
+                ++pos;
+            const char* value = pos;
+            pos = simd::FindHeaderValueEnd(pos, last);
+            if (pos == last) {
+                ret = -2;
+                return nullptr;
+            }
+            const char* value_last = pos;
+            while (value_last > value && (value_last[-1] == ' ' || value_last[-1] == '\t'))
+                --value_last;
+
+            pos = EatEol(pos, last, ret);
+            if (!pos) return nullptr;
+
+            doc->OnField(name, name_last - name, value, value_last - value);
+            has_field = true;
+            if (!framing_.OnField(name, name_last - name, value, value_last - value)) {
+                ret = -1;
+                return nullptr;
+            }
+        }
+    }
+
+    template <typename DocT>
+    inline size_t ParseBody(DocT * doc, const char* buf_ref, size_t len)
+    {
+        const char* pos = buf_ref;
+        const char* last = buf_ref + len;
+        while (pos < last) {
+            switch (state_) {
+                case ns_content_length:
+                    {
+                        size_t n = (size_t)std::min<uint64_t>(content_length_, last - pos);
+                        doc->OnBody(pos, n);
+                        pos += n;
+                        content_length_ -= n;
+                        if (!content_length_) {
+                            state_ = ns_done;
+                            doc->OnMessageComplete();
+                            return pos - buf_ref;
+                        }
+                    }
+                    break;
+
+                case ns_chunked:
+                    pos += chunked_decoder_.Parse(doc, pos, last - pos);
+                    if (doc->ParseError())
+                        return 0;
+                    if (chunked_decoder_.Done()) {
+                        state_ = ns_done;
+                        doc->OnMessageComplete();
+                        return pos - buf_ref;
+                    }
+                    break;
+
+                case ns_until_eof:
+                    doc->OnBody(pos, last - pos);
+                    return len;
+
+                default:
+                    return pos - buf_ref;
+            }
+        }
+        return pos - buf_ref;
+    }
+
+private:
+    int state_ = ns_header;
+    bool http09_ = false;
+    bool first_line_done_ = false;
+    MessageFraming framing_;        // 决定body长度的头部域
+    uint64_t content_length_ = 0;   // 剩余未读取的body长度
+    ChunkedDecoder chunked_decoder_;
+    std::string header_cache_;      // 不完整的头部缓存, 头部解析完成后字段可能引用这里
+};
+
+} //namespace rapidhttp
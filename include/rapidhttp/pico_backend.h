@@ -0,0 +1,236 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <rapidhttp/pico_layer.hpp>
+#include <rapidhttp/constants.h>
+#include <rapidhttp/error_code.h>
+#include <rapidhttp/util.h>
+#include <rapidhttp/chunked_decoder.h>
+#include <rapidhttp/message_framing.h>
+
+namespace rapidhttp {
+
+// 基于picohttpparser的解析引擎.
+// pico一次性解析完整的头部(SSE4.2加速), 头部不完整时缓存已收到的数据,
+// 下次追加后重新解析, 并用last_len告诉pico已经检查过的长度.
+// chunked body不用phr_decode_chunked(原地解码, 要先拷贝输入), 而是用ChunkedDecoder逐块引用输入.
+class PicoBackend
+{
+public:
+    template <typename DocT>
+    inline void Init(DocT * doc)
+    {
+    }
+
+    template <typename DocT>
+    inline void Reset(DocT * doc)
+    {
+        state_ = ps_header;
+        content_length_ = 0;
+        chunked_decoder_.Reset();
+        header_cache_.clear();
+    }
+
+    template <typename DocT>
+    inline size_t PartailParse(DocT * doc, const char* buf_ref, size_t len)
+    {
+        size_t parsed = 0;
+        if (state_ == ps_header) {
+            parsed = ParseHeader(doc, buf_ref, len);
+            if (doc->ParseError() || state_ == ps_header || doc->pause_at_headers_)
+                return parsed;
+        }
+
+        if (!doc->ParseDone())
+            parsed += ParseBody(doc, buf_ref + parsed, len - parsed);
+        return parsed;
+    }
+
+    template <typename DocT>
+    inline bool PartailParseEof(DocT * doc)
+    {
+        if (state_ == ps_until_eof)
+            doc->OnMessageComplete();
+        else if (state_ != ps_header || !header_cache_.empty())
+            doc->OnParseError(MakeErrorCode(eErrorCode::parse_error));
+        return doc->ParseDone();
+    }
+
+    template <typename DocT>
+    inline void CopyTo(PicoBackend & clone, DocT * clone_doc) const
+    {
+        // 从缓存中解析的字段引用的是this->header_cache_和trailer缓存, 改为引用clone的缓存
+        clone = *this;
+        if (!header_cache_.empty())
+            clone_doc->Rebase(header_cache_.data(), header_cache_.size(), clone.header_cache_.data());
+        clone.chunked_decoder_.RebaseCache(clone_doc, chunked_decoder_.CacheData());
+    }
+
+    template <typename DocT>
+    inline void MoveTo(PicoBackend & dst, DocT * dst_doc)
+    {
+        // 短的缓存在std::string内部(SSO), 移动后地址会改变
+        const char* old_base = header_cache_.data();
+        size_t cache_len = header_cache_.size();
+        const char* old_trailer = chunked_decoder_.CacheData();
+        dst = std::move(*this);
+        if (cache_len)
+            dst_doc->Rebase(old_base, cache_len, dst.header_cache_.data());
+        dst.chunked_decoder_.RebaseCache(dst_doc, old_trailer);
+    }
+
+private:
+    enum ePicoState
+    {
+        ps_header,          // 解析头部
+        ps_content_length,  // 按Content-Length读取body
+        ps_chunked,         // 按chunked读取body
+        ps_until_eof,       // 读取body直到链接断开
+    };
+
+    template <typename DocT>
+    inline size_t ParseHeader(DocT * doc, const char* buf_ref, size_t len)
+    {
+        const char* buf = buf_ref;
+        size_t buf_len = len;
+        size_t last_len = header_cache_.size();
+        if (last_len) {
+            header_cache_.append(buf_ref, len);
+            buf = header_cache_.data();
+            buf_len = header_cache_.size();
+        }
+
+        struct phr_header headers[c_pico_max_headers];
+        size_t num_headers = c_pico_max_headers;
+        int minor_version = 0;
+        int status = 0;
+        int ret;
+        if (doc->IsRequest()) {
+            const char *method, *path;
+            size_t method_len, path_len;
+            ret = phr_parse_request(buf, buf_len, &method, &method_len, &path, &path_len,
+                    &minor_version, headers, &num_headers, last_len);
+            if (ret > 0) {
+                doc->OnMethod(method, method_len);
+                doc->OnUrl(path, path_len);
+            }
+        } else {
+            const char *msg;
+            size_t msg_len;
+            ret = phr_parse_response(buf, buf_len, &minor_version, &status, &msg, &msg_len,
+                    headers, &num_headers, last_len);
+            if (ret > 0) {
+                doc->SetStatusCode(status);
+                doc->OnStatus(msg, msg_len);
+            }
+        }
+
+        if (ret == -2) {
+            // 与NativeBackend一样限制缓存长度, 否则无穷的头部会让每个链接缓存收到的所有数据
+            if (buf_len > c_max_header_cache_size) {
+                doc->OnParseError(MakeErrorCode(eErrorCode::parse_error));
+                return 0;
+            }
+            if (!last_len)
+                header_cache_.assign(buf_ref, len);
+            return len;
+        }
+
+        if (ret < 0 || !OnHeaders(doc, status, headers, num_headers)) {
+            doc->OnParseError(MakeErrorCode(eErrorCode::parse_error));
+            return 0;
+        }
+
+        doc->SetMajor(1);
+        doc->SetMinor(minor_version);
+        doc->OnHeadersComplete();
+        if (state_ == ps_content_length && !content_length_)
+            doc->OnMessageComplete();
+        return ret - last_len;
+    }
+
+    template <typename DocT>
+    inline bool OnHeaders(DocT * doc, int status, struct phr_header *headers, size_t num_headers)
+    {
+        // 与NativeBackend共用判定规则
+        MessageFraming framing;
+        for (size_t i = 0; i < num_headers; ++i) {
+            struct phr_header & h = headers[i];
+            // 多行的头部域name为空, 续接到上一个域
+            doc->OnField(h.name, h.name_len, h.value, h.value_len);
+            if (!framing.OnField(h.name, h.name_len, h.value, h.value_len))
+                return false;
+        }
+        if (!framing.Valid())
+            return false;
+
+        // CONNECT或者没有body的Upgrade消息在头部结尾处结束, 之后的数据属于其他协议
+        bool connect = doc->IsRequest() && doc->GetMethod() == "CONNECT";
+        if ((framing.upgrade && framing.connection_upgrade) || connect) {
+            doc->OnUpgrade();
+            if (connect || (!framing.chunked && !framing.content_length)) {
+                state_ = ps_content_length;
+                content_length_ = 0;
+                return true;
+            }
+        }
+
+        content_length_ = framing.content_length;
+        if (framing.chunked)
+            state_ = ps_chunked;
+        else if (framing.has_content_length)
+            state_ = ps_content_length;
+        else if (doc->IsRequest() || status / 100 == 1 || status == 204 || status == 304)
+            state_ = ps_content_length;
+        else
+            state_ = ps_until_eof;
+        return true;
+    }
+
+    template <typename DocT>
+    inline size_t ParseBody(DocT * doc, const char* buf_ref, size_t len)
+    {
+        // 头部恰好在输入结尾时没有body数据, 不回调空的body片段
+        if (!len)
+            return 0;
+
+        switch (state_) {
+            case ps_content_length:
+                {
+                    size_t n = (size_t)std::min<uint64_t>(content_length_, len);
+                    doc->OnBody(buf_ref, n);
+                    content_length_ -= n;
+                    if (!content_length_)
+                        doc->OnMessageComplete();
+                    return n;
+                }
+
+            case ps_chunked:
+                {
+                    // 与NativeBackend共用解码器: 每个块的数据直接引用输入缓冲区回调OnBody
+                    size_t n = chunked_decoder_.Parse(doc, buf_ref, len);
+                    if (chunked_decoder_.Done())
+                        doc->OnMessageComplete();
+                    return n;
+                }
+
+            case ps_until_eof:
+                doc->OnBody(buf_ref, len);
+                return len;
+
+            default:
+                return 0;
+        }
+    }
+
+private:
+    int state_ = ps_header;
+    uint64_t content_length_ = 0;   // 剩余未读取的body长度
+    ChunkedDecoder chunked_decoder_;
+    std::string header_cache_;      // 不完整的头部缓存, 头部解析完成后字段可能引用这里
+};
+
+} //namespace rapidhttp
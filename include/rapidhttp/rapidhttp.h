@@ -1,3 +1,4 @@
 #pragma once
 
 #include <rapidhttp/document.h>
+#include <rapidhttp/document_pool.h>
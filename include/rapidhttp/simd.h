@@ -0,0 +1,343 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define RAPIDHTTP_SIMD_X86 1
+# include <immintrin.h>
+#else
+# define RAPIDHTTP_SIMD_X86 0
+#endif
+
+// 头部和uri扫描的向量化内核.
+// 每个内核都有AVX2(32字节), SSE4.2/SSE2(16字节)和逐字节三个版本, 第一次调用时按CPU能力选择,
+// 所以同一个二进制文件可以运行在不支持AVX2的机器上.
+namespace rapidhttp {
+namespace simd {
+
+enum eCharClass
+{
+    cc_token = 1,           // RFC7230 tchar, 头部域名/method允许的字符
+    cc_header_value = 2,    // 头部域值允许的字符: HT, 0x20-0x7e, obs-text(0x80-0xff)
+};
+
+inline const uint8_t* CharClassTable()
+{
+    static const uint8_t table[256] = {
+    //  0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0,  // 0x00
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x10
+        2, 3, 2, 3, 3, 3, 3, 3, 2, 2, 3, 3, 2, 3, 3, 2,  // 0x20  !"#$%&'()*+,-./
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2,  // 0x30 0-9:;<=>?
+        2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  // 0x40 @A-O
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 3, 3,  // 0x50 P-Z[\]^_
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  // 0x60 `a-o
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 3, 2, 3, 0,  // 0x70 p-z{|}~DEL
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // 0x80 obs-text
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    };
+    return table;
+}
+
+inline bool IsToken(char c)
+{
+    return CharClassTable()[(uint8_t)c] & cc_token;
+}
+
+inline bool IsHeaderValue(char c)
+{
+    return CharClassTable()[(uint8_t)c] & cc_header_value;
+}
+
+/// ------------------- scalar ---------------------
+inline const char* FindHeaderValueEndScalar(const char* pos, const char* last)
+{
+    while (pos < last && IsHeaderValue(*pos))
+        ++pos;
+    return pos;
+}
+
+inline const char* FindTokenEndScalar(const char* pos, const char* last, bool allow_space)
+{
+    while (pos < last && (IsToken(*pos) || (allow_space && *pos == ' ')))
+        ++pos;
+    return pos;
+}
+
+inline const char* FindEscapeScalar(const char* pos, const char* last, bool plus)
+{
+    while (pos < last && *pos != '%' && (!plus || *pos != '+'))
+        ++pos;
+    return pos;
+}
+
+inline const char* FindPathSpecialScalar(const char* pos, const char* last)
+{
+    for (; pos + 1 < last; ++pos)
+        if (pos[0] == '/' && (pos[1] == '/' || pos[1] == '.'))
+            return pos;
+    return last;
+}
+/// ------------------------------------------------
+
+#if RAPIDHTTP_SIMD_X86
+// token集合的nibble查找表: 以低4位为下标, 第n位表示高4位为n的字符属于token
+# define _RAPIDHTTP_TOKEN_NIBBLES \
+    (char)0xe8, (char)0xfc, (char)0xf8, (char)0xfc, (char)0xfc, (char)0xfc, (char)0xfc, (char)0xfc, \
+    (char)0xf8, (char)0xf8, (char)0xf4, (char)0x54, (char)0xd0, (char)0x54, (char)0xf4, (char)0x70
+# define _RAPIDHTTP_HIGH_NIBBLE_BITS \
+    1, 2, 4, 8, 16, 32, 64, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0
+
+/// ------------------- SSE4.2 ---------------------
+__attribute__((target("sse4.2")))
+inline const char* FindHeaderValueEndSse42(const char* pos, const char* last)
+{
+    // 不允许出现在值中的字符: 0x00-0x08, 0x0a-0x1f, 0x7f
+    static const char ranges[16] = "\x00\x08\x0a\x1f\x7f\x7f";
+    const __m128i r = _mm_loadu_si128((const __m128i*)ranges);
+    for (; last - pos >= 16; pos += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)pos);
+        int idx = _mm_cmpestri(r, 6, v, 16,
+                _SIDD_LEAST_SIGNIFICANT | _SIDD_CMP_RANGES | _SIDD_UBYTE_OPS);
+        if (idx != 16)
+            return pos + idx;
+    }
+    return FindHeaderValueEndScalar(pos, last);
+}
+
+__attribute__((target("sse4.2")))
+inline const char* FindTokenEndSse42(const char* pos, const char* last, bool allow_space)
+{
+    const __m128i nibbles = _mm_setr_epi8(_RAPIDHTTP_TOKEN_NIBBLES);
+    const __m128i high_bits = _mm_setr_epi8(_RAPIDHTTP_HIGH_NIBBLE_BITS);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i space_enable = allow_space ? _mm_set1_epi8(-1) : _mm_setzero_si128();
+    for (; last - pos >= 16; pos += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)pos);
+        __m128i rows = _mm_shuffle_epi8(nibbles, _mm_and_si128(v, mask));
+        __m128i bits = _mm_shuffle_epi8(high_bits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i token = _mm_or_si128(
+                _mm_xor_si128(_mm_cmpeq_epi8(_mm_and_si128(rows, bits), _mm_setzero_si128()),
+                    _mm_set1_epi8(-1)),
+                _mm_and_si128(_mm_cmpeq_epi8(v, space), space_enable));
+        unsigned m = ~(unsigned)_mm_movemask_epi8(token) & 0xffff;
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindTokenEndScalar(pos, last, allow_space);
+}
+/// ------------------------------------------------
+
+/// ------------------- SSE2 -----------------------
+__attribute__((target("sse2")))
+inline const char* FindEscapeSse2(const char* pos, const char* last, bool plus)
+{
+    const __m128i percent = _mm_set1_epi8('%');
+    const __m128i plus_char = _mm_set1_epi8(plus ? '+' : '%');
+    for (; last - pos >= 16; pos += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)pos);
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(v, percent), _mm_cmpeq_epi8(v, plus_char)));
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindEscapeScalar(pos, last, plus);
+}
+
+__attribute__((target("sse2")))
+inline const char* FindPathSpecialSse2(const char* pos, const char* last)
+{
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i dot = _mm_set1_epi8('.');
+    // 同时读取pos和pos+1开始的16字节, 比较相邻的两个字节
+    for (; last - pos >= 17; pos += 16) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)pos);
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(pos + 1));
+        __m128i special = _mm_and_si128(_mm_cmpeq_epi8(v0, slash),
+                _mm_or_si128(_mm_cmpeq_epi8(v1, slash), _mm_cmpeq_epi8(v1, dot)));
+        unsigned m = (unsigned)_mm_movemask_epi8(special);
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindPathSpecialScalar(pos, last);
+}
+/// ------------------------------------------------
+
+/// ------------------- AVX2 -----------------------
+__attribute__((target("avx2")))
+inline const char* FindHeaderValueEndAvx2(const char* pos, const char* last)
+{
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    for (; last - pos >= 32; pos += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)pos);
+        __m256i is_ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v);
+        __m256i bad = _mm256_or_si256(
+                _mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), is_ctl),
+                _mm256_cmpeq_epi8(v, del));
+        unsigned m = (unsigned)_mm256_movemask_epi8(bad);
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindHeaderValueEndSse42(pos, last);
+}
+
+__attribute__((target("avx2")))
+inline const char* FindTokenEndAvx2(const char* pos, const char* last, bool allow_space)
+{
+    const __m256i nibbles = _mm256_setr_epi8(_RAPIDHTTP_TOKEN_NIBBLES, _RAPIDHTTP_TOKEN_NIBBLES);
+    const __m256i high_bits = _mm256_setr_epi8(_RAPIDHTTP_HIGH_NIBBLE_BITS, _RAPIDHTTP_HIGH_NIBBLE_BITS);
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i space_enable = allow_space ? _mm256_set1_epi8(-1) : _mm256_setzero_si256();
+    for (; last - pos >= 32; pos += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)pos);
+        __m256i rows = _mm256_shuffle_epi8(nibbles, _mm256_and_si256(v, mask));
+        __m256i bits = _mm256_shuffle_epi8(high_bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i not_token = _mm256_andnot_si256(
+                _mm256_and_si256(_mm256_cmpeq_epi8(v, space), space_enable),
+                _mm256_cmpeq_epi8(_mm256_and_si256(rows, bits), _mm256_setzero_si256()));
+        unsigned m = (unsigned)_mm256_movemask_epi8(not_token);
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindTokenEndSse42(pos, last, allow_space);
+}
+
+__attribute__((target("avx2")))
+inline const char* FindEscapeAvx2(const char* pos, const char* last, bool plus)
+{
+    const __m256i percent = _mm256_set1_epi8('%');
+    const __m256i plus_char = _mm256_set1_epi8(plus ? '+' : '%');
+    for (; last - pos >= 32; pos += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)pos);
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, percent), _mm256_cmpeq_epi8(v, plus_char)));
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindEscapeSse2(pos, last, plus);
+}
+
+__attribute__((target("avx2")))
+inline const char* FindPathSpecialAvx2(const char* pos, const char* last)
+{
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i dot = _mm256_set1_epi8('.');
+    for (; last - pos >= 33; pos += 32) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)pos);
+        __m256i v1 = _mm256_loadu_si256((const __m256i*)(pos + 1));
+        __m256i special = _mm256_and_si256(_mm256_cmpeq_epi8(v0, slash),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v1, slash), _mm256_cmpeq_epi8(v1, dot)));
+        unsigned m = (unsigned)_mm256_movemask_epi8(special);
+        if (m)
+            return pos + __builtin_ctz(m);
+    }
+    return FindPathSpecialSse2(pos, last);
+}
+/// ------------------------------------------------
+
+# undef _RAPIDHTTP_TOKEN_NIBBLES
+# undef _RAPIDHTTP_HIGH_NIBBLE_BITS
+#endif
+
+/// ------------------- dispatch -------------------
+typedef const char* (*FindHeaderValueEndFunc)(const char*, const char*);
+typedef const char* (*FindTokenEndFunc)(const char*, const char*, bool);
+typedef const char* (*FindEscapeFunc)(const char*, const char*, bool);
+typedef const char* (*FindPathSpecialFunc)(const char*, const char*);
+
+inline FindHeaderValueEndFunc SelectFindHeaderValueEnd()
+{
+#if RAPIDHTTP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return FindHeaderValueEndAvx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return FindHeaderValueEndSse42;
+#endif
+    return FindHeaderValueEndScalar;
+}
+
+inline FindTokenEndFunc SelectFindTokenEnd()
+{
+#if RAPIDHTTP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return FindTokenEndAvx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return FindTokenEndSse42;
+#endif
+    return FindTokenEndScalar;
+}
+
+inline FindEscapeFunc SelectFindEscape()
+{
+#if RAPIDHTTP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return FindEscapeAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return FindEscapeSse2;
+#endif
+    return FindEscapeScalar;
+}
+
+inline FindPathSpecialFunc SelectFindPathSpecial()
+{
+#if RAPIDHTTP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return FindPathSpecialAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return FindPathSpecialSse2;
+#endif
+    return FindPathSpecialScalar;
+}
+
+// 返回[pos, last)中第一个不允许出现在头部域值中的字符(通常是CR), 没有则返回last
+inline const char* FindHeaderValueEnd(const char* pos, const char* last)
+{
+    static const FindHeaderValueEndFunc func = SelectFindHeaderValueEnd();
+    return func(pos, last);
+}
+
+// 返回[pos, last)中第一个不是token的字符(通常是':'), 没有则返回last
+// @allow_space: 空格也算作token(http-parser的非严格模式)
+inline const char* FindTokenEnd(const char* pos, const char* last, bool allow_space = false)
+{
+    static const FindTokenEndFunc func = SelectFindTokenEnd();
+    return func(pos, last, allow_space);
+}
+
+// 返回[pos, last)中第一个'%'(@plus为true时还有'+'), 没有则返回last
+inline const char* FindEscape(const char* pos, const char* last, bool plus = false)
+{
+    // 不足一个向量宽度时, 逐字节比间接调用更快
+    if (last - pos < 16)
+        return FindEscapeScalar(pos, last, plus);
+    static const FindEscapeFunc func = SelectFindEscape();
+    return func(pos, last, plus);
+}
+
+// 返回[pos, last)中第一个后面紧跟着'/'或'.'的'/', 即可能需要规范化的位置, 没有则返回last
+inline const char* FindPathSpecial(const char* pos, const char* last)
+{
+    if (last - pos < 17)
+        return FindPathSpecialScalar(pos, last);
+    static const FindPathSpecialFunc func = SelectFindPathSpecial();
+    return func(pos, last);
+}
+/// ------------------------------------------------
+
+} //namespace simd
+} //namespace rapidhttp
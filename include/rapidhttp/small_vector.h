@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <assert.h>
+
+namespace rapidhttp {
+
+// 带内联存储的vector, 元素不超过N个时不分配堆内存.
+// 只实现了document需要的接口. 超过N个元素后转到堆上, 按2倍增长, clear不释放内存.
+// @Alloc: 申请堆内存使用的分配器, 必须可以默认构造
+template <typename T, size_t N, typename Alloc = std::allocator<T>>
+class SmallVector
+{
+    static_assert(N > 0, "SmallVector needs inline capacity");
+
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<T> alloc_t;
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef T const* const_iterator;
+
+    SmallVector()
+        : data_(InlineData()), size_(0), capacity_(N)
+    {}
+
+    SmallVector(SmallVector const& other) = delete;
+    SmallVector& operator=(SmallVector const& other) = delete;
+
+    SmallVector(SmallVector && other)
+        : data_(InlineData()), size_(0), capacity_(N)
+    {
+        Steal(other);
+    }
+
+    SmallVector& operator=(SmallVector && other)
+    {
+        if (this == &other) return *this;
+
+        clear();
+        Release();
+        Steal(other);
+        return *this;
+    }
+
+    ~SmallVector()
+    {
+        clear();
+        Release();
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return !size_; }
+
+    // 是否还在使用内联存储
+    bool is_inline() const { return data_ == InlineData(); }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    T & operator[](size_t index)
+    {
+        assert(index < size_);
+        return data_[index];
+    }
+    T const& operator[](size_t index) const
+    {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    T & back()
+    {
+        assert(size_);
+        return data_[size_ - 1];
+    }
+    T const& back() const
+    {
+        assert(size_);
+        return data_[size_ - 1];
+    }
+
+    template <typename ... Args>
+    void emplace_back(Args && ... args)
+    {
+        if (size_ == capacity_)
+            Grow(capacity_ * 2);
+        new (data_ + size_) T(std::forward<Args>(args)...);
+        ++size_;
+    }
+
+    void push_back(T const& v) { emplace_back(v); }
+    void push_back(T && v) { emplace_back(std::move(v)); }
+
+    void reserve(size_t n)
+    {
+        if (n > capacity_)
+            Grow(n);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < size_; ++i)
+            data_[i].~T();
+        size_ = 0;
+    }
+
+private:
+    T* InlineData() const
+    {
+        return (T*)&inline_;
+    }
+
+    // 把元素移动到容量为n的堆内存上
+    void Grow(size_t n)
+    {
+        T* buf = alloc_t().allocate(n);
+        for (size_t i = 0; i < size_; ++i) {
+            new (buf + i) T(std::move(data_[i]));
+            data_[i].~T();
+        }
+        Release();
+        data_ = buf;
+        capacity_ = n;
+    }
+
+    // 释放堆内存, 回到内联存储. 元素必须已经析构
+    void Release()
+    {
+        if (!is_inline())
+            alloc_t().deallocate(data_, capacity_);
+        data_ = InlineData();
+        capacity_ = N;
+    }
+
+    // 接管other的元素, 调用前this必须为空且使用内联存储
+    void Steal(SmallVector & other)
+    {
+        if (other.is_inline()) {
+            for (size_t i = 0; i < other.size_; ++i)
+                new (data_ + i) T(std::move(other.data_[i]));
+            size_ = other.size_;
+            other.clear();
+        } else {
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = other.InlineData();
+            other.size_ = 0;
+            other.capacity_ = N;
+        }
+    }
+
+private:
+    T* data_;
+    // 头部域的数量不会超过uint32_t, 用32位减小document的大小
+    uint32_t size_;
+    uint32_t capacity_;
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+};
+
+} //namespace rapidhttp
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <rapidhttp/arena.h>
 
 namespace rapidhttp {
 
@@ -21,7 +22,7 @@ public:
     StringRef(StringRef const& other)
     {
         if (other.owner_ && other.len_) {
-            char* buf = (char*)malloc(other.len_);
+            char* buf = (char*)malloc(Capacity(other.len_));
             memcpy(buf, other.str_, other.len_);
             str_ = buf;
         } else
@@ -38,7 +39,7 @@ public:
             free((void*)str_);
 
         if (other.owner_ && other.len_) {
-            char* buf = (char*)malloc(other.len_);
+            char* buf = (char*)malloc(Capacity(other.len_));
             memcpy(buf, other.str_, other.len_);
             str_ = buf;
         } else
@@ -91,6 +92,12 @@ public:
         return str_;
     }
 
+    // 与std::string/std::string_view一致的接口
+    const char* data() const
+    {
+        return str_;
+    }
+
     size_t size() const
     {
         return len_;
@@ -129,7 +136,7 @@ public:
     void SetOwner()
     {
         if (!owner_ && len_) {
-            char* buf = (char*)malloc(len_);
+            char* buf = (char*)malloc(Capacity(len_));
             memcpy(buf, str_, len_);
             str_ = buf;
             owner_ = true;
@@ -154,9 +161,11 @@ public:
             size_t new_len = len_ + (last - first);
             char* buf = nullptr;
             if (owner_) {
-                buf = (char*)realloc((void*)str_, new_len);
+                buf = (char*)str_;
+                if (new_len > Capacity(len_))
+                    buf = (char*)realloc(buf, Capacity(new_len));
             } else {
-                buf = (char*)malloc(new_len);
+                buf = (char*)malloc(Capacity(new_len));
                 memcpy(buf, str_, len_);
             }
 
@@ -167,6 +176,55 @@ public:
         }
     }
 
+    // 不连续时把数据拷贝到arena中, 不再单独malloc. 拷贝后不拥有所有权, 由arena统一回收.
+    // arena中最后一次分配的字符串继续追加时原地扩展, 不用重新拷贝.
+    template <typename ArenaT>
+    void append(const char* first, size_t length, ArenaT & arena)
+    {
+        if (!length) return ;
+
+        if (!len_) {
+            str_ = first;
+            len_ = length;
+        } else if (!owner_ && str_ + len_ == first) {
+            len_ += length;
+        } else if (!owner_ && arena.Extend(str_, len_, len_ + length)) {
+            memcpy((char*)str_ + len_, first, length);
+            len_ += length;
+        } else {
+            char* buf = arena.Allocate(len_ + length);
+            memcpy(buf, str_, len_);
+            memcpy(buf + len_, first, length);
+            if (owner_)
+                free((void*)str_);
+            str_ = buf;
+            len_ += length;
+            owner_ = false;
+        }
+    }
+
+    // 引用的数据从[old_base, old_base + len)整体移到了new_base, 修正引用的地址.
+    // 拥有所有权或不在这个范围内的不变
+    void Rebase(const char* old_base, size_t len, const char* new_base)
+    {
+        if (!owner_ && len_ && str_ >= old_base && str_ + len_ <= old_base + len)
+            str_ = new_base + (str_ - old_base);
+    }
+
+    // 把引用的数据拷贝到arena中
+    template <typename ArenaT>
+    void CopyToArena(ArenaT & arena)
+    {
+        if (!len_) return ;
+
+        char* buf = arena.Allocate(len_);
+        memcpy(buf, str_, len_);
+        if (owner_)
+            free((void*)str_);
+        str_ = buf;
+        owner_ = false;
+    }
+
     /// ------------- string assign operator ---------------
 public:
     StringRef& operator=(const char* cstr)
@@ -243,6 +301,16 @@ public:
     }
     /// -----------------------------------------------------
 
+private:
+    // 拥有所有权的缓冲区容量, 按2的幂增长, 连续append时摊还O(1)
+    static size_t Capacity(size_t len)
+    {
+        size_t cap = 16;
+        while (cap < len)
+            cap <<= 1;
+        return cap;
+    }
+
 private:
     bool owner_ : 1;
     uint32_t len_ : 31;
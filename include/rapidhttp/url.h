@@ -0,0 +1,270 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <rapidhttp/layer.hpp>
+#include <rapidhttp/stringref.h>
+#include <rapidhttp/simd.h>
+
+namespace rapidhttp {
+
+// 分解后的URL.
+// 各部分都是引用原始uri的StringRef, 不拷贝数据, 使用期间必须保证uri有效且不变.
+struct UrlView
+{
+    StringRef schema;
+    StringRef host;
+    StringRef port;
+    StringRef path;
+    StringRef query;
+    StringRef fragment;
+    StringRef userinfo;
+    uint16_t port_value = 0;    // 没有port时为0
+    bool valid = false;         // 是否分解成功
+
+    /// 分解uri
+    // @is_connect: CONNECT请求的uri是authority形式(host:port)
+    // @returns: 是否分解成功, 失败时所有部分都为空
+    inline bool Parse(const char* uri, size_t len, bool is_connect)
+    {
+        *this = UrlView();
+
+        if (!len)
+            return false;
+
+        // origin-form(/path?query#fragment)是最常见的形式, 直接切分,
+        // 不走http-parser的逐字节状态机. 字符的合法性在解析请求行时已经检查过了.
+        if (!is_connect && uri[0] == '/') {
+            const char* last = uri + len;
+            const char* hash = (const char*)memchr(uri, '#', len);
+            const char* end = hash ? hash : last;
+            const char* qmark = (const char*)memchr(uri, '?', end - uri);
+            path = StringRef(uri, (qmark ? qmark : end) - uri);
+            if (qmark)
+                query = StringRef(qmark + 1, end - qmark - 1);
+            if (hash)
+                fragment = StringRef(hash + 1, last - hash - 1);
+            valid = true;
+            return true;
+        }
+
+        struct http_parser_url u;
+        http_parser_url_init(&u);
+        if (http_parser_parse_url(uri, len, is_connect ? 1 : 0, &u) != 0)
+            return false;
+
+#define _URL_FIELD(field, uf) \
+        if (u.field_set & (1 << uf)) \
+            field = StringRef(uri + u.field_data[uf].off, u.field_data[uf].len)
+
+        _URL_FIELD(schema, UF_SCHEMA);
+        _URL_FIELD(host, UF_HOST);
+        _URL_FIELD(port, UF_PORT);
+        _URL_FIELD(path, UF_PATH);
+        _URL_FIELD(query, UF_QUERY);
+        _URL_FIELD(fragment, UF_FRAGMENT);
+        _URL_FIELD(userinfo, UF_USERINFO);
+#undef _URL_FIELD
+
+        port_value = u.port;
+        valid = true;
+        return true;
+    }
+};
+
+// 遍历query string中的参数(k1=v1&k2=v2), key/value引用query的数据, 不分配内存.
+// 空的参数(&&)会被跳过, 没有'='的参数value为空, key/value都不做解码.
+class QueryIterator
+{
+public:
+    QueryIterator()
+        : pos_(nullptr), last_(nullptr)
+    {}
+
+    QueryIterator(const char* query, size_t len)
+        : pos_(query), last_(query + len)
+    {}
+
+    explicit QueryIterator(StringRef const& query)
+        : pos_(query.c_str()), last_(query.c_str() + query.size())
+    {}
+
+    /// 取下一个参数
+    // @returns: 没有更多参数时返回false
+    inline bool Next(StringRef & key, StringRef & value)
+    {
+        while (pos_ < last_) {
+            const char* first = pos_;
+            const char* amp = (const char*)memchr(pos_, '&', last_ - pos_);
+            const char* end = amp ? amp : last_;
+            pos_ = amp ? amp + 1 : last_;
+            if (first == end)
+                continue;
+
+            const char* eq = (const char*)memchr(first, '=', end - first);
+            if (eq) {
+                key = StringRef(first, eq - first);
+                value = StringRef(eq + 1, end - eq - 1);
+            } else {
+                key = StringRef(first, end - first);
+                value = StringRef();
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    const char* pos_;
+    const char* last_;
+};
+
+inline int HexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/// percent解码
+// 把[src, src + len)解码后写入buf, 解码后不会变长, 所以buf可以等于src(原地解码).
+// 不需要解码的连续字符用向量化内核一次跳过16/32字节, 原地解码时在第一个转义之前不需要拷贝.
+// @plus_as_space: 把'+'解码为空格(application/x-www-form-urlencoded, 用于query)
+// @returns: 解码后的长度, %后面不是两位16进制数或buf空间不足时返回-1
+inline long PercentDecode(const char* src, size_t len, char* buf, size_t buf_len,
+        bool plus_as_space = false)
+{
+    const char* last = src + len;
+    char* out = buf;
+    char* out_last = buf + buf_len;
+    // 短输入(比如query中的value)逐字节解码, 避免向量化内核的调用开销
+    if (len < 16) {
+        for (; src < last; ++out) {
+            if (out == out_last)
+                return -1;
+            char c = *src;
+            if (c == '%') {
+                if (last - src < 3)
+                    return -1;
+                int hi = HexDigitValue(src[1]);
+                int lo = HexDigitValue(src[2]);
+                if (hi < 0 || lo < 0)
+                    return -1;
+                *out = (char)(hi << 4 | lo);
+                src += 3;
+            } else {
+                *out = (plus_as_space && c == '+') ? ' ' : c;
+                ++src;
+            }
+        }
+        return out - buf;
+    }
+
+    while (src < last) {
+        const char* run = simd::FindEscape(src, last, plus_as_space);
+        size_t n = run - src;
+        if (n) {
+            if (n > (size_t)(out_last - out))
+                return -1;
+            if (out != src)
+                memmove(out, src, n);
+            out += n;
+            src = run;
+            if (src == last)
+                break;
+        }
+
+        if (out == out_last)
+            return -1;
+
+        if (*src == '+') {
+            *out++ = ' ';
+            ++src;
+            continue;
+        }
+
+        if (last - src < 3)
+            return -1;
+        int hi = HexDigitValue(src[1]);
+        int lo = HexDigitValue(src[2]);
+        if (hi < 0 || lo < 0)
+            return -1;
+        *out++ = (char)(hi << 4 | lo);
+        src += 3;
+    }
+    return out - buf;
+}
+
+// 检查所有的'%'后面都是两位16进制数
+inline bool IsValidPercentEncoding(const char* src, size_t len)
+{
+    const char* last = src + len;
+    while ((src = simd::FindEscape(src, last)) != last) {
+        if (last - src < 3 || HexDigitValue(src[1]) < 0 || HexDigitValue(src[2]) < 0)
+            return false;
+        src += 3;
+    }
+    return true;
+}
+
+/// 移除path中的"."和".."段(RFC3986 5.2.4), 合并连续的'/'
+// 原地修改, ".."不会越过根目录, 以"/."或"/.."结尾时保留结尾的'/'.
+// @returns: 结果的长度
+inline size_t RemoveDotSegments(char* path, size_t len)
+{
+    const char* pos = path;
+    const char* last = path + len;
+    char* out = path;
+    while (pos < last) {
+        // 普通的字符原样保留
+        const char* special = simd::FindPathSpecial(pos, last);
+        size_t n = special - pos;
+        if (out != pos)
+            memmove(out, pos, n);
+        out += n;
+        pos = special;
+        if (pos == last)
+            break;
+
+        // pos指向后面紧跟'/'或'.'的'/'
+        if (pos[1] == '/') {
+            ++pos;
+        } else if (pos + 2 == last || pos[2] == '/') {
+            // "/."
+            pos += 2;
+            if (pos == last)
+                *out++ = '/';
+        } else if (pos[2] == '.' && (pos + 3 == last || pos[3] == '/')) {
+            // "/..", 回退一段
+            while (out > path && out[-1] != '/')
+                --out;
+            if (out > path)
+                --out;
+            pos += 3;
+            if (pos == last)
+                *out++ = '/';
+        } else {
+            // 以'.'开头的普通段, 如"/.hidden"
+            out[0] = pos[0];
+            out[1] = pos[1];
+            out += 2;
+            pos += 2;
+        }
+    }
+    return out - path;
+}
+
+/// 规范化uri的path: percent解码, 移除"."和".."段, 合并连续的'/'
+// 先解码再移除, 所以"%2e%2e"也会被当作".."处理.
+// 把[src, src + len)的结果写入buf, buf可以等于src(原地规范化).
+// @returns: 结果的长度, 解码失败或buf空间不足时返回-1
+inline long NormalizePath(const char* src, size_t len, char* buf, size_t buf_len)
+{
+    long n = PercentDecode(src, len, buf, buf_len);
+    if (n < 0)
+        return n;
+    return RemoveDotSegments(buf, n);
+}
+
+} //namespace rapidhttp
@@ -30,6 +30,78 @@ inline size_t UIntegerByteSize(uint32_t i)
         return 10;
 }
 
+inline char ToLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (c | 0x20) : c;
+}
+
+// 头部域名允许的字符(RFC 7230 tchar)
+inline bool IsTokenChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+        (c && strchr("!#$%&'*+-.^_`|~", c));
+}
+
+// 忽略大小写比较
+inline bool CaseInsensitiveEqual(const char* lhs, size_t lhs_len, const char* rhs, size_t rhs_len)
+{
+    if (lhs_len != rhs_len) return false;
+    for (size_t i = 0; i < lhs_len; ++i)
+        if (ToLower(lhs[i]) != ToLower(rhs[i]))
+            return false;
+    return true;
+}
+
+// 忽略大小写的哈希(FNV-1a)
+inline uint32_t CaseInsensitiveHash(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t)ToLower(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 在逗号分隔的列表中查找token(忽略大小写), 如: Connection: keep-alive, Upgrade
+inline bool ContainsToken(const char* v, size_t v_len, const char* token, size_t token_len)
+{
+    const char* pos = v;
+    const char* last = v + v_len;
+    while (pos < last) {
+        while (pos < last && (*pos == ' ' || *pos == '\t' || *pos == ','))
+            ++pos;
+        const char* first = pos;
+        while (pos < last && *pos != ',')
+            ++pos;
+        const char* end = pos;
+        while (end > first && (end[-1] == ' ' || end[-1] == '\t'))
+            --end;
+        if (CaseInsensitiveEqual(first, end - first, token, token_len))
+            return true;
+    }
+    return false;
+}
+
+// Transfer-Encoding的最后一个编码是否是chunked, 如: Transfer-Encoding: gzip, chunked
+// 必须去掉OWS后完全相等(忽略大小写), "xchunked"或"chunked, gzip"都不是chunked.
+inline bool IsChunkedCoding(const char* v, size_t v_len)
+{
+    const char* first = v;
+    const char* last = v + v_len;
+    for (const char* pos = last; pos > v; --pos) {
+        if (pos[-1] == ',') {
+            first = pos;
+            break;
+        }
+    }
+    while (first < last && (*first == ' ' || *first == '\t'))
+        ++first;
+    while (last > first && (last[-1] == ' ' || last[-1] == '\t'))
+        --last;
+    return CaseInsensitiveEqual(first, last - first, "chunked", 7);
+}
+
 inline const char* SkipSpaces(const char* pos, const char* last)
 {
     for (; pos < last && *pos == ' '; ++pos)
@@ -2,6 +2,11 @@
 
 dest=$1/include/rapidhttp/layer.hpp
 
+if [ ! -f $1/third_party/http-parser/http_parser.c ]; then
+    echo "http-parser not found, keep $dest"
+    exit 0
+fi
+
 echo "#pragma once" > $dest
 cat $1/third_party/http-parser/http_parser.h >> $dest
 sed -i 's/extern\ "C"/namespace rapidhttp/g' $dest
@@ -40,4 +45,11 @@ sed -i 's/^const char \*$/inline &/g' $dest
 
 sed -i 's/^\#include "http_parser.h"//g' $dest
 
+# header name/value scanning with SIMD kernels (rapidhttp/simd.h)
+# a patch that no longer applies to this http-parser version must fail the build
+if ! patch -s $dest < $1/scripts/http_parser_simd.patch; then
+    echo "apply http_parser_simd.patch to $dest failed"
+    exit 1
+fi
+
 echo "create http-parser $dest"
@@ -1,6 +1,11 @@
 #!/bin/sh
 
-dest=$1/include/rapidhttp/layer.hpp
+dest=$1/include/rapidhttp/pico_layer.hpp
+
+if [ ! -f $1/third_party/picohttpparser/picohttpparser.c ]; then
+    echo "picohttpparser not found, keep $dest"
+    exit 0
+fi
 
 echo "#pragma once" > $dest
 cat $1/third_party/picohttpparser/picohttpparser.h >> $dest
@@ -25,4 +30,10 @@ sed -i 's/^int phr_decode_chunked_is_in_data(.*/inline &/g' $dest
 sed -i 's/^static .*(.*/inline &/g' $dest
 sed -i 's/^\#include "picohttpparser.h"//g' $dest
 
+# pico's private macros must not leak into layer.hpp(http-parser) or user code
+for m in ALIGNED likely unlikely IS_PRINTABLE_ASCII CHECK_EOF EXPECT_CHAR_NO_CHECK \
+    EXPECT_CHAR ADVANCE_TOKEN PARSE_INT PARSE_INT_3; do
+    echo "#undef $m" >> $dest
+done
+
 echo "create pico $dest"
@@ -194,5 +194,11 @@ TEST(parse, response)
 {
     test_parse_response<rapidhttp::HttpDocument>();
     test_parse_response<rapidhttp::HttpDocumentRef>();
+    test_parse_response<rapidhttp::NativeHttpDocument>();
+    test_parse_response<rapidhttp::NativeHttpDocumentRef>();
+#if USE_PICO
+    test_parse_response<rapidhttp::PicoHttpDocument>();
+    test_parse_response<rapidhttp::PicoHttpDocumentRef>();
+#endif
     copyto_response();
 }